@@ -102,7 +102,7 @@ int HX711_ADC::startMultiple(unsigned long t)
 			return 0;
 		}
 		else { //do tare after stabilization time is up
-			static unsigned long timeout = millis() + tareTimeOut;
+			static unsigned long timeout = millis() + getTareTimeOut();
 			doTare = 1;
 			update();
 			if(convRslt == 2) 
@@ -153,7 +153,7 @@ int HX711_ADC::startMultiple(unsigned long t, bool dotare)
 		else { //do tare after stabilization time is up
 			if (dotare) 
 			{
-				static unsigned long timeout = millis() + tareTimeOut;
+				static unsigned long timeout = millis() + getTareTimeOut();
 				doTare = 1;
 				update();
 				if(convRslt == 2) 
@@ -184,7 +184,7 @@ void HX711_ADC::tare()
 	doTare = 1;
 	tareTimes = 0;
 	tareTimeoutFlag = 0;
-	unsigned long timeout = millis() + tareTimeOut;
+	unsigned long timeout = millis() + getTareTimeOut();
 	while(rdy != 2) 
 	{
 		rdy = update();
@@ -292,6 +292,16 @@ void HX711_ADC::conversion24bit()  //read 24 bit data, store in dataset and star
 {
 	conversionTime = micros() - conversionStartTime;
 	conversionStartTime = micros();
+	if(conversionTimeAvg == 0)
+	{
+		if(conversionTime < 500000) conversionTimeAvg = conversionTime; //first plausible interval (>2SPS), not the time since boot
+	}
+	else
+	{
+		float interval = conversionTime;
+		if(interval > 2 * conversionTimeAvg) interval = 2 * conversionTimeAvg; //update() was not called for a while
+		conversionTimeAvg += (interval - conversionTimeAvg) / (1 << SPS_EMA_SHIFT);
+	}
 	unsigned long data = 0;
 	uint8_t dout;
 	convRslt = 0;
@@ -321,6 +331,17 @@ void HX711_ADC::conversion24bit()  //read 24 bit data, store in dataset and star
 		dataOutOfRange = 1;
 		//Serial.println("dataOutOfRange");
 	}
+	if (data == 0 || data >= 0xFFFFFF) 
+	{
+		//ADC at its limit (saturated, broken wire): counted and kept, the dataset fills and a tare ends,
+		//a single one is a spike for the Hampel filter
+		dataOutOfRange = 1;
+		saturatedSamples++;
+		if (data == 0) data = 1; //0 is no conversion for the dataset
+	}
+	#if HAMPEL_WINDOW
+	data = (unsigned long)hampelFilter((long)data);
+	#endif
 	if (readIndex == samplesInUse + IGN_HIGH_SAMPLE + IGN_LOW_SAMPLE - 1) 
 	{
 		readIndex = 0;
@@ -351,6 +372,92 @@ void HX711_ADC::conversion24bit()  //read 24 bit data, store in dataset and star
 	}
 }
 
+#if HAMPEL_WINDOW
+//streaming Hampel filter, constant time: sort of HAMPEL_WINDOW values
+long HX711_ADC::hampelFilter(long data)
+{
+	hampelSet[hampelIndex] = data;
+	hampelIndex = (hampelIndex + 1) % HAMPEL_WINDOW;
+	long diff = labs(data - hampelLast); //against the last conversion let through, not against a spike
+	if (hampelFilled < HAMPEL_WINDOW) 
+	{
+		hampelLast = data;
+		//first conversions: learn the noise, from the second one on (the first has nothing to compare with)
+		if (hampelFilled > 0) 
+		{
+			hampelNoise += (diff - hampelNoise) / hampelFilled;
+		}
+		hampelFilled++;
+		return data;
+	}
+
+	long sorted[HAMPEL_WINDOW];
+	for (uint8_t i = 0; i < HAMPEL_WINDOW; i++) 
+	{
+		long v = hampelSet[i];
+		int8_t j = i - 1;
+		for (; j >= 0 && sorted[j] > v; j--) 
+		{
+			sorted[j + 1] = sorted[j];
+		}
+		sorted[j + 1] = v;
+	}
+	long median = sorted[HAMPEL_WINDOW / 2];
+
+	if (labs(data - median) > HAMPEL_FAC * hampelNoise + 1) 
+	{
+		int8_t side = data > median ? 1 : -1;
+		if (side == hampelSide) 
+		{
+			//second outlier on the same side: a step or a ramp, not a spike => through, no count
+			hampelReplaced = false;
+			hampelLast = data;
+			return data;
+		}
+		//first one: held back, counted when the next conversion shows it was alone
+		hampelSide = side;
+		hampelReplaced = true;
+		return median;
+	}
+	if (hampelReplaced) 
+	{
+		rejectedSamples++; //isolated outlier = spike
+	}
+	hampelSide = 0;
+	hampelReplaced = false;
+	hampelLast = data;
+	hampelNoise += (diff - hampelNoise) / 32; //only from good conversions, a spike or a step does not raise the threshold
+	return data;
+}
+#endif
+
+//returns the number of spikes replaced by the Hampel filter
+unsigned long HX711_ADC::getRejectedSamples()
+{
+	return rejectedSamples;
+}
+
+//returns the number of conversions at 0 or 0xFFFFFF (after the bit flip)
+unsigned long HX711_ADC::getSaturatedSamples()
+{
+	return saturatedSamples;
+}
+
+//returns the HX711 conversions ea second based on the averaged conversion time, 0 until the first conversion
+float HX711_ADC::getMeasuredSPS()
+{
+	if(conversionTimeAvg == 0) return 0;
+	return 1000000.0/conversionTimeAvg;
+}
+
+//returns the tare timeout: the dataset at the measured rate + 50% margin, before the first conversion 10SPS is assumed
+unsigned long HX711_ADC::getTareTimeOut()
+{
+	if(conversionTimeAvg == 0) return tareTimeOut;
+	unsigned long t = (samplesInUse + IGN_HIGH_SAMPLE + IGN_LOW_SAMPLE) * conversionTimeAvg * 1.5 / 1000;
+	return t + 400; //+ the HX711 settling time after a power up
+}
+
 //power down the HX711
 void HX711_ADC::powerDown() 
 {
@@ -26,6 +26,10 @@ Note: HX711_ADC configuration values has been moved to file config.h
 	#error "number of SAMPLES not valid!"
 #endif
 
+#if (HAMPEL_WINDOW != 0) & (HAMPEL_WINDOW != 3) & (HAMPEL_WINDOW != 5)
+	#error "HAMPEL_WINDOW not valid!"
+#endif
+
 #if 		(SAMPLES == 1)
 #define 	DIVB 0
 #elif 		(SAMPLES == 2)
@@ -82,10 +86,15 @@ class HX711_ADC
 		bool getDataSetStatus();					//returns 'true' when the whole dataset has been filled up with conversions, i.e. after a reset/restart
 		float getNewCalibration(float known_mass);	//returns and sets a new calibration value (calFactor) based on a known mass input
 		bool getSignalTimeoutFlag();				//returns 'true' if it takes longer time then 'SIGNAL_TIMEOUT' for the dout pin to go low after a new conversion is started
+		unsigned long getRejectedSamples();			//spikes replaced by the Hampel filter since begin()
+		unsigned long getSaturatedSamples();		//conversions at the ADC limits (saturated, broken wire) since begin(), they are kept in the dataset
+		float getMeasuredSPS();						//returns the conversions ea second from the averaged conversion time, 0 if not measured yet
 
 	protected:
 		void conversion24bit(); 					//if conversion is ready: returns 24 bit data and starts the next conversion
 		long smoothedData();						//returns the smoothed data value calculated from the dataset
+		long hampelFilter(long data);				//returns data, or the median of the last conversions if data is a spike
+		unsigned long getTareTimeOut();				//returns the tare timeout in ms for the measured rate
 		uint8_t sckPin; 							//HX711 pd_sck pin
 		uint8_t doutPin; 							//HX711 dout pin
 		uint8_t GAIN;								//HX711 GAIN
@@ -96,6 +105,7 @@ class HX711_ADC
 		int readIndex = 0;
 		unsigned long conversionStartTime;
 		unsigned long conversionTime;
+		float conversionTimeAvg = 0;				//EMA of conversionTime in us, 0 = no plausible interval yet
 		uint8_t isFirst = 1;
 		uint8_t tareTimes;
 		uint8_t divBit = DIVB;
@@ -114,6 +124,17 @@ class HX711_ADC
 		bool dataOutOfRange = 0;
 		unsigned long lastDoutLowTime = 0;
 		bool signalTimeoutFlag = 0;
+		unsigned long rejectedSamples = 0;
+		unsigned long saturatedSamples = 0;
+		#if HAMPEL_WINDOW
+		long hampelSet[HAMPEL_WINDOW];				//last conversions, raw
+		uint8_t hampelIndex = 0;
+		uint8_t hampelFilled = 0;
+		long hampelLast = 0;
+		float hampelNoise = 0;						//running mean of |conversion - last conversion| without the spikes
+		int8_t hampelSide = 0;						//side of the last outlier (+1/-1), 0 = last conversion was no outlier
+		bool hampelReplaced = false;				//the last outlier was replaced by the median, not yet counted
+		#endif
 };	
 
 #endif
@@ -39,3 +39,15 @@ Note that you can also overide (reducing) the number of samples in use at any ti
 //if required you can change the value to '1' to disable interrupts when writing to the sck pin.
 #define SCK_DISABLE_INTERRUPTS		0		//default value: 0
 
+//streaming Hampel filter in conversion24bit(), before the moving average dataset: a conversion this far
+//from the median of the last HAMPEL_WINDOW conversions is replaced by the median (single sample spikes).
+//value must be 0 (off), 3 or 5. The first outlier of a real step or ramp is held back one conversion,
+//the second one on the same side goes through; only isolated outliers count as rejected.
+#define HAMPEL_WINDOW				3		//default value: 3
+//threshold in multiples of the running noise (mean of |conversion - last conversion|)
+#define HAMPEL_FAC					8		//default value: 8
+
+//the conversion interval is averaged (EMA over approx 2^SPS_EMA_SHIFT conversions) for getMeasuredSPS() and the tare timeout.
+//one interval counts with at most twice the average, a long pause of update() calls does not move the rate much.
+#define SPS_EMA_SHIFT				3		//default value: 3
+
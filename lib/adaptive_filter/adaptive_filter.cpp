@@ -0,0 +1,70 @@
+#include "adaptive_filter.h"
+
+void adaptive_filter_reset(adaptive_filter_t &af)
+{
+    af.head = 0;
+    af.filled = 0;
+    af.window = 1;
+    af.noise = 0.0f;
+    af.last = 0.0f;
+    af.onsets = 0;
+}
+
+//average of the newest af.window values
+static float window_mean(const adaptive_filter_t &af)
+{
+    int n = af.window < af.filled ? af.window : af.filled;
+    float sum = 0.0f;
+    for (int i = 1; i <= n; i++)
+    {
+        sum += af.buf[(af.head - i + AF_MAX_WINDOW) % AF_MAX_WINDOW];
+    }
+    return sum / n;
+}
+
+float adaptive_filter_update(adaptive_filter_t &af, float x, int max_window)
+{
+    if (max_window < 1)
+        max_window = 1;
+    if (max_window > AF_MAX_WINDOW)
+        max_window = AF_MAX_WINDOW;
+
+    if (af.filled < AF_MAX_WINDOW)
+    {
+        //first samples: learn the noise, no onset detection yet
+        if (af.filled > 0)
+            af.noise += (fabsf(x - af.last) - af.noise) / (af.filled + 1);
+        if (af.window < max_window)
+            af.window++;
+    }
+    else
+    {
+        float d = fabsf(x - af.last);
+        float threshold = AF_STEP_FAC * af.noise;
+
+        if (d > threshold || fabsf(x - window_mean(af)) > threshold)
+        {
+            //fast change: raw value out, start the window again
+            if (af.window > 1)
+                af.onsets++;
+            af.window = 1;
+        }
+        else
+        {
+            //noise only from the quiet samples, an onset does not blow up the threshold
+            af.noise += (d - af.noise) / (1 << AF_NOISE_SHIFT);
+            if (af.window < max_window)
+                af.window++;
+        }
+    }
+    if (af.window > max_window)
+        af.window = max_window;
+
+    af.buf[af.head] = x;
+    af.head = (af.head + 1) % AF_MAX_WINDOW;
+    if (af.filled < AF_MAX_WINDOW)
+        af.filled++;
+    af.last = x;
+
+    return window_mean(af);
+}
@@ -0,0 +1,27 @@
+#ifndef ADAPTIVE_FILTER_H
+#define ADAPTIVE_FILTER_H
+#include <math.h> //no Arduino.h, tools/filter_bench builds this on the PC
+
+#define AF_MAX_WINDOW 32    //longest moving average
+#define AF_STEP_FAC 8.0f    //onset: change this many times the noise away from the average
+#define AF_NOISE_SHIFT 5    //noise EMA over approx 2^5 = 32 samples
+
+//moving average what collapses to the raw value on a fast change (break onset)
+//and widens again by one sample per sample => no old values in the window after a step
+struct adaptive_filter_t
+{
+    float buf[AF_MAX_WINDOW]; //last inputs, ring buffer
+    int head;                 //next write position
+    int filled;               //valid values in buf
+    int window;               //current averaging length
+    float noise;              //EMA of |x - previous x| without the onsets
+    float last;               //previous input
+    unsigned long onsets;     //detected fast changes since reset
+};
+
+void adaptive_filter_reset(adaptive_filter_t &af);
+
+//one new HX711 value in, filtered value out, max_window = steady state window (1 - AF_MAX_WINDOW)
+float adaptive_filter_update(adaptive_filter_t &af, float x, int max_window);
+
+#endif
@@ -0,0 +1,58 @@
+#include "auto_zero.h"
+
+void auto_zero_reset(auto_zero_t &az)
+{
+    az.mean = 0.0f;
+    az.var = 0.0f;
+    az.stable_count = 0;
+    az.total_raw = 0;
+}
+
+long auto_zero_update(auto_zero_t &az, float load, float dead_zone, float calfac, float sps)
+{
+    float band = AZ_BAND_FAC * dead_zone;
+    float noise = AZ_NOISE_FAC * dead_zone;
+
+    //any load on the pedal: start again, never move the zero under load
+    if (fabs(load) >= band)
+    {
+        az.mean = load;
+        az.var = 0.0f;
+        az.stable_count = 0;
+        return 0;
+    }
+
+    const float alpha = 1.0f / (1 << AZ_EMA_SHIFT);
+    float dev = load - az.mean;
+    az.mean += alpha * dev;
+    az.var += alpha * (dev * dev - az.var);
+
+    if (az.var > noise * noise)
+    {
+        az.stable_count = 0;
+        return 0;
+    }
+
+    //the times in samples at the measured rate, so 10 and 80 SPS boards wait the same
+    int settle_samples = max(1, int(AZ_SETTLE_MS * sps / 1000.0f));
+    int step_samples = max(1, int(AZ_STEP_MS * sps / 1000.0f));
+
+    az.stable_count++;
+    if (az.stable_count < settle_samples || (az.stable_count % step_samples) != 0)
+    {
+        return 0;
+    }
+
+    //total correction is limited to one dead zone, more than that needs a real tare
+    long limit_raw = (long)fabs(dead_zone * calfac);
+    long step = lround(az.mean * calfac);
+    step = constrain(step, (long)-AZ_MAX_STEP_RAW, (long)AZ_MAX_STEP_RAW);
+    if (labs(az.total_raw + step) > limit_raw)
+    {
+        return 0;
+    }
+
+    az.total_raw += step;
+    az.mean -= step / calfac; //the mean follows the new zero
+    return step;
+}
@@ -0,0 +1,27 @@
+#ifndef AUTO_ZERO_H
+#define AUTO_ZERO_H
+#include <Arduino.h>
+
+#define AZ_BAND_FAC 0.5f      //idle if |load| < this part of the dead zone (min_break)
+#define AZ_NOISE_FAC 0.1f     //and the std. deviation < this part of the dead zone
+#define AZ_SETTLE_MS 1000     //that long idle before the zero is touched
+#define AZ_STEP_MS 90         //time between two corrections (8 samples at 89 SPS)
+#define AZ_MAX_STEP_RAW 4     //max tare offset change per correction in raw HX711 counts
+#define AZ_EMA_SHIFT 4        //mean/variance EMA over approx 2^4 = 16 samples
+
+//zero tracking state, one per load cell
+struct auto_zero_t
+{
+    float mean;       //EMA of the idle load
+    float var;        //EMA of the squared deviation
+    int stable_count; //samples in a row within band and quiet
+    long total_raw;   //sum of all corrections since the last tare
+};
+
+void auto_zero_reset(auto_zero_t &az);
+
+//feed one load value (relative to the current tare) at the measured rate sps, returns the raw
+//correction to add to the tare offset, 0 while loaded, moving or between two steps
+long auto_zero_update(auto_zero_t &az, float load, float dead_zone, float calfac, float sps);
+
+#endif
@@ -0,0 +1,102 @@
+#include "bt_link.h"
+
+BtLink::BtLink(const char *name) : name(name), on(false), last_active(0), lock(NULL)
+{
+}
+
+bool BtLink::start()
+{
+    if (lock == NULL)
+    {
+        lock = xSemaphoreCreateMutexStatic(&lock_buf); //first start, the scheduler is running
+    }
+    if (on)
+    {
+        return true;
+    }
+    if (!bt.begin(name))
+    {
+        bt.end(); //what did start of the stack goes down again
+        return false;
+    }
+    last_active = millis();
+    on = true;
+    return true;
+}
+
+void BtLink::stop()
+{
+    if (!on)
+    {
+        return;
+    }
+    xSemaphoreTake(lock, portMAX_DELAY);
+    on = false;
+    xSemaphoreGive(lock);
+    bt.end();
+}
+
+bool BtLink::running()
+{
+    return on;
+}
+
+void BtLink::service()
+{
+    if (!on)
+    {
+        return;
+    }
+    if (bt.hasClient() || bt.available() > 0)
+    {
+        last_active = millis();
+    }
+    else if (millis() - last_active > BT_IDLE_MS)
+    {
+        stop();
+    }
+}
+
+int BtLink::available()
+{
+    return on ? bt.available() : 0;
+}
+
+int BtLink::read()
+{
+    return on ? bt.read() : -1;
+}
+
+int BtLink::peek()
+{
+    return on ? bt.peek() : -1;
+}
+
+size_t BtLink::write(uint8_t c)
+{
+    return write(&c, 1);
+}
+
+size_t BtLink::write(const uint8_t *buffer, size_t size)
+{
+    if (!on)
+    {
+        return 0;
+    }
+    size_t n = 0;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (on) //not stopped while waiting
+    {
+        n = bt.write(buffer, size);
+    }
+    xSemaphoreGive(lock);
+    return n;
+}
+
+void BtLink::flush()
+{
+    if (on)
+    {
+        bt.flush();
+    }
+}
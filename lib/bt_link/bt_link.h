@@ -0,0 +1,37 @@
+#ifndef BT_LINK_H
+#define BT_LINK_H
+#include <Arduino.h>
+#include <BluetoothSerial.h>
+
+#define BT_IDLE_MS 300000UL //BT goes off after 5 min without a client and without data
+
+//SerialBT what can be off: while the Bluedroid stack is stopped every call is a no-op,
+//so the prints and the command polling work the same with and without BT
+class BtLink : public Stream
+{
+public:
+    explicit BtLink(const char *name);
+
+    bool start();   //lazy start, the stack takes its RAM here, false if Bluedroid did not start
+    void stop();    //stack down, its RAM goes back to the heap
+    bool running(); //stack up (with or without a client)
+    void service(); //idle shutdown, call it from the command task
+
+    int available();
+    int read();
+    int peek();
+    size_t write(uint8_t c);
+    size_t write(const uint8_t *buffer, size_t size);
+    void flush();
+    using Print::write;
+
+private:
+    BluetoothSerial bt;
+    const char *name;
+    volatile bool on;
+    unsigned long last_active; //millis() of the last client or data
+    SemaphoreHandle_t lock;    //stop() waits for a write of another task
+    StaticSemaphore_t lock_buf;
+};
+
+#endif
@@ -0,0 +1,81 @@
+#include "calibration_fit.h"
+
+int calibration_fit(const float *x, const float *y, int n, int order, float *coef)
+{
+    if (order < 1 || order > 2 || n < order + 1)
+        return -1;
+
+    //x can be raw HX711 counts, scale it to +-1 to keep the normal equations well conditioned
+    double scale = 0.0;
+    for (int i = 0; i < n; i++)
+        scale = max(scale, (double)fabs(x[i]));
+    if (scale == 0.0)
+        return -1;
+
+    double s[5] = {0, 0, 0, 0, 0}; //sum x^k
+    double t[3] = {0, 0, 0};       //sum y*x^k
+    for (int i = 0; i < n; i++)
+    {
+        double xs = x[i] / scale;
+        double xp = 1.0;
+        for (int k = 0; k <= 2 * order; k++)
+        {
+            s[k] += xp;
+            if (k <= order)
+                t[k] += y[i] * xp;
+            xp *= xs;
+        }
+    }
+
+    int m = order + 1;
+    double a[3][4];
+    for (int r = 0; r < m; r++)
+    {
+        for (int c = 0; c < m; c++)
+            a[r][c] = s[r + c];
+        a[r][m] = t[r];
+    }
+
+    //gauss elimination with partial pivoting
+    for (int c = 0; c < m; c++)
+    {
+        int p = c;
+        for (int r = c + 1; r < m; r++)
+            if (fabs(a[r][c]) > fabs(a[p][c]))
+                p = r;
+        if (fabs(a[p][c]) < 1e-30)
+            return -1;
+        for (int k = 0; k <= m; k++)
+        {
+            double temp = a[c][k];
+            a[c][k] = a[p][k];
+            a[p][k] = temp;
+        }
+        for (int r = 0; r < m; r++)
+        {
+            if (r == c)
+                continue;
+            double f = a[r][c] / a[c][c];
+            for (int k = c; k <= m; k++)
+                a[r][k] -= f * a[c][k];
+        }
+    }
+
+    double unscale = 1.0;
+    for (int r = 0; r < m; r++)
+    {
+        coef[r] = (float)(a[r][m] / a[r][r] / unscale);
+        unscale *= scale;
+    }
+    if (order == 1)
+        coef[2] = 0.0f;
+    return 0;
+}
+
+float calibration_eval(const float *coef, int order, float x)
+{
+    float y = coef[0] + coef[1] * x;
+    if (order == 2)
+        y += coef[2] * x * x;
+    return y;
+}
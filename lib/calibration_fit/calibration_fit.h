@@ -0,0 +1,20 @@
+#ifndef CALIBRATION_FIT_H
+#define CALIBRATION_FIT_H
+#include <Arduino.h>
+
+#define CAL_MAX_POINTS 12 //reference loads in one multi point calibration
+
+//least squares fit y = coef[0] + coef[1]*x (+ coef[2]*x*x if order = 2)
+//returns 0 if ok, -1 if not enough points or the points do not define the curve
+int calibration_fit(const float *x, const float *y, int n, int order, float *coef);
+
+//value of the fitted polynomial at x
+float calibration_eval(const float *coef, int order, float x);
+
+//load corrected with the stored offset and quadratic term, O(1) per sample
+inline float calibration_correct(float load, float offset, float quad)
+{
+    return offset + load + quad * load * load;
+}
+
+#endif
@@ -0,0 +1,92 @@
+#include "cmd_line.h"
+
+void cmd_source_init(cmd_source_t &src, Stream *io, unsigned long idle_ms)
+{
+    src.io = io;
+    src.idle_ms = idle_ms;
+    src.last_ms = 0;
+    src.len = 0;
+    src.line[0] = 0;
+}
+
+static bool line_end(cmd_source_t &src)
+{
+    src.line[src.len] = 0;
+    bool complete = src.len > 0;
+    src.len = 0;
+    return complete;
+}
+
+bool cmd_read_line(cmd_source_t &src)
+{
+    while (src.io->available() > 0)
+    {
+        int ch = src.io->read();
+        if (ch < 0)
+        {
+            break;
+        }
+        src.last_ms = millis();
+        if (ch == '\n' || ch == '\r')
+        {
+            if (line_end(src))
+            {
+                return true;
+            }
+        }
+        else if (src.len < CMD_LINE_MAX - 1)
+        {
+            src.line[src.len++] = (char)ch;
+        }
+    }
+
+    if (src.idle_ms != 0 && src.len > 0 && millis() - src.last_ms > src.idle_ms)
+    {
+        return line_end(src);
+    }
+    return false;
+}
+
+bool cmd_is_kv(const char *line)
+{
+    return strchr(line, '=') != NULL || strcmp(line, "?") == 0;
+}
+
+static bool is_separator(char c)
+{
+    return c == ' ' || c == '\t' || c == ',' || c == ';';
+}
+
+int cmd_split(char *line, cmd_kv_t *kv, int max)
+{
+    int n = 0;
+    char *p = line;
+    for (;;)
+    {
+        while (is_separator(*p))
+        {
+            *p++ = 0;
+        }
+        if (*p == 0)
+        {
+            return n;
+        }
+        if (n == max)
+        {
+            return -1;
+        }
+
+        kv[n].key = p;
+        kv[n].value = NULL;
+        while (*p != 0 && !is_separator(*p))
+        {
+            if (*p == '=' && kv[n].value == NULL)
+            {
+                *p = 0;
+                kv[n].value = p + 1;
+            }
+            p++;
+        }
+        n++;
+    }
+}
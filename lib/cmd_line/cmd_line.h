@@ -0,0 +1,36 @@
+#ifndef CMD_LINE_H
+#define CMD_LINE_H
+#include <Arduino.h>
+
+#define CMD_LINE_MAX 96 //longest command line, longer ones are cut
+#define CMD_IDLE_MS 50  //a source with idle end: a line without '\n' is complete after this pause (single chars of a BT app)
+#define CMD_KV_MAX 16   //key=value pairs in one line
+
+//command lines from one byte stream (Serial, SerialBT), collected without a String
+struct cmd_source_t
+{
+    Stream *io;               //read from and replied to
+    unsigned long idle_ms;    //0 = only '\n' or '\r' ends a line
+    unsigned long last_ms;    //millis() of the last byte
+    int len;
+    char line[CMD_LINE_MAX];  //the complete line, valid after cmd_read_line() returned true
+};
+
+struct cmd_kv_t
+{
+    char *key;
+    char *value; //NULL for a key without '='
+};
+
+void cmd_source_init(cmd_source_t &src, Stream *io, unsigned long idle_ms);
+
+//read what is there, true when src.line holds a complete line (empty lines are skipped)
+bool cmd_read_line(cmd_source_t &src);
+
+//true for a key=value line or "?" (parameter query), else it is a single command
+bool cmd_is_kv(const char *line);
+
+//split "a=1 b=2;save" in place into pairs (separators: space, ',' and ';'), -1 if more than max
+int cmd_split(char *line, cmd_kv_t *kv, int max);
+
+#endif
@@ -0,0 +1,218 @@
+#include "config_store.h"
+#include <Preferences.h>
+#include <HX711_ADC.h> //SAMPLES
+
+static Preferences prefs;
+static bool prefs_open = false;
+
+static const char *slot_key[2] = {"cfg_a", "cfg_b"};
+
+static brake_config_t pending_cfg;
+static brake_config_t slot_cfg[2];
+static uint8_t slot_buf[CONFIG_BLOB_MAX]; //too big for the loop task stack
+static bool pending = false;
+static unsigned long pending_since = 0;
+static uint32_t last_sequence = 0;
+
+static void open_prefs()
+{
+    //open the namespace only one time, not on every save
+    if (!prefs_open)
+    {
+        prefs.begin("g29break", false);
+        prefs_open = true;
+    }
+}
+
+uint32_t crc32_calc(const uint8_t *data, size_t len)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        for (uint8_t b = 0; b < 8; b++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+//CRC only tells the blob is intact, this tells the values make sense for the break
+static bool config_sane(const brake_config_t &cfg)
+{
+    if (!isfinite(cfg.calibration_value) || cfg.calibration_value == 0.0f)
+        return false;
+    if (!isfinite(cfg.max_break) || !isfinite(cfg.min_break) || cfg.min_break >= cfg.max_break)
+        return false;
+    if (!(cfg.max_break_redfac > 0.0f && cfg.max_break_redfac <= 100.0f))
+        return false;
+    if (cfg.max_break_volt < 0 || cfg.max_break_volt > 255 || cfg.min_break_volt < 0 || cfg.min_break_volt > 255)
+        return false;
+    if (cfg.normal < 0 || cfg.normal > 1)
+        return false;
+    if (!(cfg.gammafac >= 0.25f && cfg.gammafac <= 4.0f))
+        return false;
+    if (!isfinite(cfg.tare_noise) || cfg.tare_noise < 0.0f)
+        return false;
+    if (!isfinite(cfg.cal_offset) || !isfinite(cfg.cal_quad))
+        return false;
+    if (cfg.lin_points != 0 && (cfg.lin_points < 2 || cfg.lin_points > LIN_MAX_POINTS))
+        return false;
+    for (int i = 0; i < cfg.lin_points; i++)
+    {
+        if (!(cfg.lin_span[i] >= 0.0f && cfg.lin_span[i] <= 1.0f && cfg.lin_game[i] >= 0.0f && cfg.lin_game[i] <= 1.0f))
+            return false;
+    }
+    if (!(cfg.creep_amplitude >= 0.0f && cfg.creep_amplitude <= 0.5f) || !(cfg.creep_tau > 0.0f && cfg.creep_tau <= 100.0f))
+        return false;
+    if (cfg.filter_mode < 0 || cfg.filter_mode > 1 || cfg.predict_on < 0 || cfg.predict_on > 1)
+        return false;
+    if (cfg.active_profile < 0 || cfg.active_profile >= PROFILE_MAX || !profile_used(cfg.profiles[cfg.active_profile]))
+        return false;
+    for (int i = 0; i < PROFILE_MAX; i++)
+    {
+        if (profile_used(cfg.profiles[i]) && !profile_sane(cfg.profiles[i]))
+            return false;
+        if (!curve_sane(cfg.curves[i]))
+            return false;
+    }
+    return true;
+}
+
+//blob older than version 6: the break fields become profile 0, the other profiles are empty
+static void migrate_profiles(brake_config_t &cfg)
+{
+    memset(cfg.profiles, 0, sizeof(cfg.profiles));
+    brake_profile_t &p = cfg.profiles[0];
+    strncpy(p.name, "default", PROFILE_NAME_LEN - 1);
+    p.max_break = cfg.max_break;
+    p.min_break = cfg.min_break;
+    p.max_break_redfac = cfg.max_break_redfac;
+    p.max_break_volt = cfg.max_break_volt;
+    p.min_break_volt = cfg.min_break_volt;
+    p.gammafac = cfg.gammafac;
+    p.filter_samples = SAMPLES;
+    p.lin_points = cfg.lin_points;
+    memcpy(p.lin_span, cfg.lin_span, sizeof(p.lin_span));
+    memcpy(p.lin_game, cfg.lin_game, sizeof(p.lin_game));
+    cfg.active_profile = 0;
+}
+
+size_t config_blob_build(const brake_config_t &cfg, uint32_t sequence, uint8_t *buf)
+{
+    config_header_t header;
+    header.magic = CONFIG_MAGIC;
+    header.version = CONFIG_VERSION;
+    header.length = sizeof(brake_config_t);
+    header.reserved = 0;
+    header.sequence = sequence;
+    header.crc = crc32_calc((const uint8_t *)&cfg, sizeof(brake_config_t));
+
+    memcpy(buf, &header, sizeof(header));
+    memcpy(buf + sizeof(header), &cfg, sizeof(brake_config_t));
+    return CONFIG_BLOB_MAX;
+}
+
+int config_blob_parse(const uint8_t *buf, size_t len, brake_config_t &cfg, uint32_t &sequence)
+{
+    if (len < sizeof(config_header_t) || len > CONFIG_BLOB_MAX)
+        return CONFIG_BLOB_HEADER;
+
+    config_header_t header;
+    memcpy(&header, buf, sizeof(header));
+
+    if (header.magic != CONFIG_MAGIC || header.version > CONFIG_VERSION)
+        return CONFIG_BLOB_HEADER;
+    if (header.length != len - sizeof(config_header_t))
+        return CONFIG_BLOB_HEADER;
+    if (crc32_calc(buf + sizeof(header), header.length) != header.crc)
+        return CONFIG_BLOB_CRC;
+
+    //fields not in an older blob keep the defaults
+    memcpy(&cfg, buf + sizeof(header), header.length);
+    if (header.version < 6)
+        migrate_profiles(cfg);
+    if (header.version < 7)
+        memset(cfg.curves, 0, sizeof(cfg.curves)); //gamma for all profiles
+    if (!config_sane(cfg))
+        return CONFIG_BLOB_VALUES;
+
+    sequence = header.sequence;
+    return CONFIG_BLOB_OK;
+}
+
+//read one slot, returns true and fills sequence if the slot is valid, cfg is overwritten in any case
+static bool read_slot(int slot, brake_config_t &cfg, uint32_t &sequence)
+{
+    uint8_t *buf = slot_buf;
+    size_t len = prefs.getBytesLength(slot_key[slot]);
+
+    if (len < sizeof(config_header_t) || len > sizeof(slot_buf))
+        return false;
+    if (prefs.getBytes(slot_key[slot], buf, len) != len)
+        return false;
+
+    return config_blob_parse(buf, len, cfg, sequence) == CONFIG_BLOB_OK;
+}
+
+int config_store_load(brake_config_t &cfg)
+{
+    open_prefs();
+
+    slot_cfg[0] = cfg;
+    slot_cfg[1] = cfg;
+    uint32_t sequence[2] = {0, 0};
+    bool valid[2];
+    bool stored[2];
+
+    for (int slot = 0; slot < 2; slot++)
+    {
+        stored[slot] = prefs.getBytesLength(slot_key[slot]) > 0;
+        valid[slot] = read_slot(slot, slot_cfg[slot], sequence[slot]);
+    }
+
+    if (!valid[0] && !valid[1])
+        return (stored[0] || stored[1]) ? -1 : 0;
+
+    int use = 0;
+    if (!valid[0] || (valid[1] && sequence[1] > sequence[0]))
+        use = 1;
+
+    cfg = slot_cfg[use];
+    last_sequence = sequence[use];
+    return 1;
+}
+
+void config_store_save(const brake_config_t &cfg)
+{
+    pending_cfg = cfg;
+    pending = true;
+    pending_since = millis();
+}
+
+bool config_store_service()
+{
+    if (!pending || millis() - pending_since < CONFIG_WRITE_DELAY_MS)
+        return false;
+
+    open_prefs();
+
+    uint32_t sequence = last_sequence + 1;
+    config_blob_build(pending_cfg, sequence, slot_buf);
+
+    //alternate A/B, the slot with the last good config is never the one being written
+    if (prefs.putBytes(slot_key[sequence & 1], slot_buf, sizeof(slot_buf)) == sizeof(slot_buf))
+    {
+        last_sequence = sequence;
+        pending = false;
+        return true;
+    }
+    pending_since = millis(); //retry later
+    return false;
+}
+
+bool config_store_pending()
+{
+    return pending;
+}
@@ -0,0 +1,102 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+#include <Arduino.h>
+#include <stddef.h>
+#include "linearization.h"
+#include "profile.h"
+
+#define CONFIG_MAGIC 0x4732        //"G2" marks a blob written by this firmware
+#define CONFIG_VERSION 9           //bump when fields are appended to brake_config_t
+#define CONFIG_WRITE_DELAY_MS 250  //write-behind: commit to NVS this long after the last change
+
+//everything what has to survive a reboot
+//fields are only appended at the end, never reordered => an older (shorter) blob still loads as prefix
+struct __attribute__((packed)) brake_config_t
+{
+    float calibration_value; //HX711 calFactor
+    float max_break;         //100% break load (raw * calFactor)
+    float min_break;         //dead zone load
+    float max_break_redfac;  //max break reduction in %
+    int32_t max_break_volt;  //DAC bit for 100% break
+    int32_t min_break_volt;  //DAC bit for 0% break
+    int32_t normal;          //0 = raw, 1 = linearized output
+    float gammafac;          //gamma of the break curve
+    //version 2
+    int32_t tare_offset;     //last good HX711 tare offset (raw), 0 = no tare stored
+    float tare_noise;        //spread of the smoothed raw data at that tare, fingerprint for the boot check
+    //version 3
+    float creep_amplitude;   //creep model amplitude as fraction, 0 = off
+    float creep_tau;         //creep model time constant in s
+    //version 4
+    float cal_offset;        //multi point calibration: load = cal_offset + x + cal_quad * x^2
+    float cal_quad;          //x = HX711 data with calibration_value as gain
+    //version 5
+    int32_t lin_points;              //measured game linearization points, 0 = built in load_percent[]
+    float lin_span[LIN_MAX_POINTS];  //DAC position between min (0.0) and max (1.0) break voltage
+    float lin_game[LIN_MAX_POINTS];  //break in the game at this position (0.0 - 1.0)
+    //version 6, the break fields above are a copy of the active profile
+    int32_t active_profile;
+    brake_profile_t profiles[PROFILE_MAX];
+    //version 7
+    brake_curve_t curves[PROFILE_MAX]; //force curve of each profile
+    //version 8
+    int32_t filter_mode;               //0 = HX711 moving average, 1 = adaptive filter
+    //version 9
+    int32_t predict_on;                //1 = group delay compensation of the filter
+};
+
+//header in front of every slot
+struct __attribute__((packed)) config_header_t
+{
+    uint16_t magic;
+    uint16_t version;
+    uint16_t length;   //payload bytes after the header
+    uint16_t reserved;
+    uint32_t sequence; //generation counter, the higher valid A/B slot wins
+    uint32_t crc;      //crc32 over the payload
+};
+
+static_assert(sizeof(config_header_t) == 16, "config_header_t layout changed");
+static_assert(offsetof(brake_config_t, max_break_volt) == 16, "brake_config_t field moved, append only");
+static_assert(offsetof(brake_config_t, gammafac) == 28, "brake_config_t field moved, append only");
+static_assert(offsetof(brake_config_t, tare_offset) == 32, "brake_config_t field moved, append only");
+static_assert(offsetof(brake_config_t, creep_amplitude) == 40, "brake_config_t field moved, append only");
+static_assert(offsetof(brake_config_t, cal_offset) == 48, "brake_config_t field moved, append only");
+static_assert(offsetof(brake_config_t, lin_points) == 56, "brake_config_t field moved, append only");
+static_assert(offsetof(brake_config_t, active_profile) == 60 + 8 * LIN_MAX_POINTS, "brake_config_t field moved, append only");
+static_assert(sizeof(brake_profile_t) == 44 + 8 * LIN_MAX_POINTS, "brake_profile_t layout changed");
+static_assert(offsetof(brake_config_t, curves) == 64 + 8 * LIN_MAX_POINTS + PROFILE_MAX * sizeof(brake_profile_t), "brake_config_t field moved, append only");
+static_assert(sizeof(brake_curve_t) == 4 + 8 * CURVE_MAX_POINTS, "brake_curve_t layout changed");
+static_assert(offsetof(brake_config_t, filter_mode) == offsetof(brake_config_t, curves) + PROFILE_MAX * sizeof(brake_curve_t), "brake_config_t field moved, append only");
+static_assert(sizeof(brake_config_t) == offsetof(brake_config_t, filter_mode) + 8, "brake_config_t size changed, update the layout checks and CONFIG_VERSION");
+
+#define CONFIG_BLOB_MAX (sizeof(config_header_t) + sizeof(brake_config_t)) //header + payload, a flash slot or a snapshot
+
+//config_blob_parse() results
+#define CONFIG_BLOB_OK 0
+#define CONFIG_BLOB_HEADER -1 //magic, newer version or length
+#define CONFIG_BLOB_CRC -2
+#define CONFIG_BLOB_VALUES -3 //intact, but not sane for the break
+
+uint32_t crc32_calc(const uint8_t *data, size_t len);
+
+//header + cfg into buf (CONFIG_BLOB_MAX bytes), the same format as in flash, returns the length
+size_t config_blob_build(const brake_config_t &cfg, uint32_t sequence, uint8_t *buf);
+
+//check a blob and copy it into cfg, an older (shorter) blob leaves the new fields of cfg as they are
+//cfg is only valid on CONFIG_BLOB_OK
+int config_blob_parse(const uint8_t *buf, size_t len, brake_config_t &cfg, uint32_t &sequence);
+
+//1 = loaded from flash, 0 = nothing stored (cfg untouched), -1 = corrupt (cfg untouched = defaults)
+int config_store_load(brake_config_t &cfg);
+
+//queue cfg for writing, the flash commit is done later in config_store_service()
+void config_store_save(const brake_config_t &cfg);
+
+//call from the loop: commits a queued save into the older A/B slot, returns true if written
+bool config_store_service();
+
+//true as long as a save is queued but not yet in flash
+bool config_store_pending();
+
+#endif
@@ -0,0 +1,18 @@
+#include "creep.h"
+
+void creep_reset(creep_t &cr)
+{
+    cr.state = 0.0f;
+}
+
+float creep_compensate(creep_t &cr, float load, float amplitude, float tau, float dt)
+{
+    if (amplitude <= 0.0f || tau <= 0.0f)
+    {
+        return load;
+    }
+
+    float compensated = load - amplitude * cr.state;
+    cr.state += (dt / (tau + dt)) * (compensated - cr.state); //backward euler lowpass, no exp() needed
+    return compensated;
+}
@@ -0,0 +1,18 @@
+#ifndef CREEP_H
+#define CREEP_H
+#include <Arduino.h>
+
+//first-order creep model of the load cell:
+//constant force F reads as F * (1 + amplitude * (1 - exp(-t / tau)))
+//compensated: x = y - amplitude * lowpass_tau(x), O(1) per sample
+struct creep_t
+{
+    float state; //lowpass of the compensated load
+};
+
+void creep_reset(creep_t &cr);
+
+//amplitude as fraction (0.02 = 2%), tau and dt in seconds, amplitude 0 = off
+float creep_compensate(creep_t &cr, float load, float amplitude, float tau, float dt);
+
+#endif
@@ -0,0 +1,27 @@
+#include "dac_interp.h"
+
+void dac_interp_reset(dac_interp_t &di, float value)
+{
+    di.from = value;
+    di.to = value;
+    di.t0 = 0;
+    di.span = 0;
+}
+
+void dac_interp_target(dac_interp_t &di, float target, unsigned long now, unsigned long span)
+{
+    di.from = dac_interp_value(di, now);
+    di.to = target;
+    di.t0 = now;
+    di.span = span;
+}
+
+float dac_interp_value(const dac_interp_t &di, unsigned long now)
+{
+    unsigned long t = now - di.t0; //unsigned, right also over the micros() overflow
+    if (t >= di.span)
+    {
+        return di.to;
+    }
+    return di.from + (di.to - di.from) * ((float)t / (float)di.span);
+}
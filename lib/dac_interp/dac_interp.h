@@ -0,0 +1,23 @@
+#ifndef DAC_INTERP_H
+#define DAC_INTERP_H
+#include <math.h> //no Arduino.h, tools/dac_ramp builds this on the PC
+
+//output side of one HX711 sample: the DAC target is reached in a straight ramp over span,
+//not as a step. The output is then at most span late, in the mean span / 2 more than the staircase.
+struct dac_interp_t
+{
+    float from;         //output when the target came
+    float to;           //target of the last sample
+    unsigned long t0;   //time of the target in us
+    unsigned long span; //ramp time in us, 0 = step (staircase)
+};
+
+void dac_interp_reset(dac_interp_t &di, float value);
+
+//new target at now (us), the ramp starts at the current output, so a target during a ramp has no jump
+void dac_interp_target(dac_interp_t &di, float target, unsigned long now, unsigned long span);
+
+//output at now (us), the target itself after the ramp
+float dac_interp_value(const dac_interp_t &di, unsigned long now);
+
+#endif
@@ -0,0 +1,114 @@
+#include "heap_guard.h"
+
+#if STATIC_ALLOC
+static TaskHandle_t guarded[HEAP_GUARD_TASKS];
+static volatile int allowed[HEAP_GUARD_TASKS]; //nesting count of heap_guard_allow(true)
+static volatile int guarded_count = 0;
+static volatile unsigned long hits = 0;
+static TaskHandle_t volatile last_task = NULL;
+
+static int guard_index(TaskHandle_t task)
+{
+    for (int i = 0; i < guarded_count; i++)
+    {
+        if (guarded[i] == task)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+//called on every malloc/calloc/realloc, also from the IDF and the BT stack: only a few compares
+static void guard_check()
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    int i = guard_index(self);
+    if (i >= 0 && allowed[i] == 0)
+    {
+        hits++;
+        last_task = self;
+    }
+}
+
+extern "C" void *__real_malloc(size_t size);
+extern "C" void *__real_calloc(size_t n, size_t size);
+extern "C" void *__real_realloc(void *p, size_t size);
+
+extern "C" void *__wrap_malloc(size_t size)
+{
+    guard_check();
+    return __real_malloc(size);
+}
+
+extern "C" void *__wrap_calloc(size_t n, size_t size)
+{
+    guard_check();
+    return __real_calloc(n, size);
+}
+
+extern "C" void *__wrap_realloc(void *p, size_t size)
+{
+    guard_check();
+    return __real_realloc(p, size);
+}
+
+void heap_guard_add(TaskHandle_t task)
+{
+    if (task == NULL || guarded_count >= HEAP_GUARD_TASKS || guard_index(task) >= 0)
+    {
+        return;
+    }
+    allowed[guarded_count] = 0;
+    guarded[guarded_count] = task;
+    guarded_count++; //last, the check only looks at complete entries
+}
+
+void heap_guard_allow(bool allow)
+{
+    int i = guard_index(xTaskGetCurrentTaskHandle());
+    if (i < 0)
+    {
+        return;
+    }
+    if (allow)
+    {
+        allowed[i]++;
+    }
+    else if (allowed[i] > 0)
+    {
+        allowed[i]--;
+    }
+}
+
+unsigned long heap_guard_hits()
+{
+    return hits;
+}
+
+const char *heap_guard_last()
+{
+    return last_task != NULL ? pcTaskGetName(last_task) : "";
+}
+
+#else
+
+void heap_guard_add(TaskHandle_t task)
+{
+}
+
+void heap_guard_allow(bool allow)
+{
+}
+
+unsigned long heap_guard_hits()
+{
+    return 0;
+}
+
+const char *heap_guard_last()
+{
+    return "";
+}
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef HEAP_GUARD_H
+#define HEAP_GUARD_H
+#include <Arduino.h>
+
+//build mode: tasks and mutexes in static memory, no heap in the running paths (env:lolin32_static)
+//the heap calls are counted through the linker: -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc
+#ifndef STATIC_ALLOC
+#define STATIC_ALLOC 0
+#endif
+
+#define HEAP_GUARD_TASKS 8 //tasks what can be guarded
+
+//count every heap call of this task from now on (after its creation in setup())
+void heap_guard_add(TaskHandle_t task);
+
+//the calling task may use the heap until the matching heap_guard_allow(false), calls nest
+//(the flash write, the BT stack buffers)
+void heap_guard_allow(bool allow);
+
+//heap calls of the guarded tasks while not allowed, 0 if STATIC_ALLOC is off
+unsigned long heap_guard_hits();
+
+//name of the task of the last counted heap call, "" if none
+const char *heap_guard_last();
+
+#endif
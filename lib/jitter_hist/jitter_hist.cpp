@@ -0,0 +1,31 @@
+#include "jitter_hist.h"
+
+void jitter_hist_reset(jitter_hist_t &jh)
+{
+    for (int i = 0; i < JH_BUCKETS; i++)
+    {
+        jh.count[i] = 0;
+    }
+    jh.n = 0;
+    jh.max = 0;
+}
+
+void jitter_hist_add(jitter_hist_t &jh, unsigned long us)
+{
+    int i = 0;
+    while (i < JH_BUCKETS - 1 && us >= jitter_hist_limit(i))
+    {
+        i++;
+    }
+    jh.count[i]++;
+    jh.n++;
+    if (us > jh.max)
+    {
+        jh.max = us;
+    }
+}
+
+unsigned long jitter_hist_limit(int i)
+{
+    return i < JH_BUCKETS - 1 ? 1UL << (i + JH_FIRST_SHIFT) : 0;
+}
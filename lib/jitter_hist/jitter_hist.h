@@ -0,0 +1,21 @@
+#ifndef JITTER_HIST_H
+#define JITTER_HIST_H
+
+#define JH_BUCKETS 12    //bucket i: below 2^(i + JH_FIRST_SHIFT) us, the last one is all above
+#define JH_FIRST_SHIFT 4 //first bucket below 16 us
+
+//log2 histogram of a time in us (task wake latency, output period), O(1) per value
+struct jitter_hist_t
+{
+    unsigned long count[JH_BUCKETS];
+    unsigned long n;
+    unsigned long max;
+};
+
+void jitter_hist_reset(jitter_hist_t &jh);
+void jitter_hist_add(jitter_hist_t &jh, unsigned long us);
+
+//upper limit of bucket i in us, 0 for the last one (no limit)
+unsigned long jitter_hist_limit(int i);
+
+#endif
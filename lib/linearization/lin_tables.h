@@ -0,0 +1,84 @@
+#ifndef LIN_TABLES_H
+#define LIN_TABLES_H
+#include "linearization.h"
+
+//measured by hand for one G29 and GT Sport: break in the game, index 0 = 100% at max_break_volt,
+//index 78 = 0% at min_break_volt, the DAC bit in between is linear to the index
+#define LOAD_PERCENT_STEPS 79
+constexpr float load_percent[LOAD_PERCENT_STEPS] = {1.0, 0.963, 0.93, 0.895, 0.86, 0.835, 0.804, 0.776, 0.749, 0.725,
+                                                    0.701, 0.68, 0.66, 0.642, 0.625, 0.609, 0.595, 0.58, 0.564, 0.55,
+                                                    0.535, 0.525, 0.512, 0.498, 0.485, 0.475, 0.462, 0.455, 0.447, 0.439,
+                                                    0.431, 0.423, 0.416, 0.408, 0.4, 0.392, 0.384, 0.377, 0.369, 0.361,
+                                                    0.353, 0.345, 0.337, 0.33, 0.322, 0.314, 0.306, 0.298, 0.291, 0.283,
+                                                    0.275, 0.267, 0.259, 0.252, 0.247, 0.236, 0.228, 0.220, 0.212, 0.205,
+                                                    0.197, 0.189, 0.181, 0.173, 0.166, 0.158, 0.15, 0.142, 0.134, 0.127,
+                                                    0.116, 0.105, 0.094, 0.078, 0.063, 0.047, 0.031, 0.016, 0.0};
+
+//gamma presets, these cost no RAM and no pow() at runtime
+#define LIN_PRESETS 5
+constexpr float lin_preset_gamma[LIN_PRESETS] = {0.5f, 1.0f, 1.8f, 2.0f, 4.0f};
+
+struct lin_curve_t
+{
+    float v[LIN_CURVE_SIZE];
+};
+
+//load_percent[] as ascending points
+struct lin_points_t
+{
+    float span[LOAD_PERCENT_STEPS];
+    float game[LOAD_PERCENT_STEPS];
+};
+
+constexpr lin_points_t lin_builtin_points()
+{
+    lin_points_t pts = {};
+    for (int k = 0; k < LOAD_PERCENT_STEPS; k++)
+    {
+        pts.span[k] = (float)k / (LOAD_PERCENT_STEPS - 1);
+        pts.game[k] = load_percent[LOAD_PERCENT_STEPS - 1 - k];
+    }
+    return pts;
+}
+
+constexpr lin_curve_t lin_make_curve(float gamma)
+{
+    lin_points_t pts = lin_builtin_points();
+    float lut[LIN_LUT_SIZE] = {};
+    lin_build(pts.span, pts.game, LOAD_PERCENT_STEPS, lut, LIN_LUT_SIZE);
+
+    lin_curve_t curve = {};
+    lin_compose(lut, LIN_LUT_SIZE, gamma, curve.v, LIN_CURVE_SIZE);
+    return curve;
+}
+
+constexpr lin_points_t lin_builtin = lin_builtin_points();
+static_assert(lin_is_monotone(lin_builtin.game, LOAD_PERCENT_STEPS), "load_percent[] must fall from 100% to 0%");
+
+//read-only, in flash
+constexpr lin_curve_t lin_preset_curve[LIN_PRESETS] = {
+    lin_make_curve(lin_preset_gamma[0]),
+    lin_make_curve(lin_preset_gamma[1]),
+    lin_make_curve(lin_preset_gamma[2]),
+    lin_make_curve(lin_preset_gamma[3]),
+    lin_make_curve(lin_preset_gamma[4]),
+};
+
+static_assert(lin_is_monotone(lin_preset_curve[0].v, LIN_CURVE_SIZE), "preset curve gamma 0.5 not monotone");
+static_assert(lin_is_monotone(lin_preset_curve[1].v, LIN_CURVE_SIZE), "preset curve gamma 1.0 not monotone");
+static_assert(lin_is_monotone(lin_preset_curve[2].v, LIN_CURVE_SIZE), "preset curve gamma 1.8 not monotone");
+static_assert(lin_is_monotone(lin_preset_curve[3].v, LIN_CURVE_SIZE), "preset curve gamma 2.0 not monotone");
+static_assert(lin_is_monotone(lin_preset_curve[4].v, LIN_CURVE_SIZE), "preset curve gamma 4.0 not monotone");
+
+//index of the preset for this gamma, -1 = custom gamma
+inline int lin_preset_find(float gamma)
+{
+    for (int i = 0; i < LIN_PRESETS; i++)
+    {
+        if (fabs(gamma - lin_preset_gamma[i]) < 0.0001f)
+            return i;
+    }
+    return -1;
+}
+
+#endif
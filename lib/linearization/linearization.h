@@ -0,0 +1,206 @@
+#ifndef LINEARIZATION_H
+#define LINEARIZATION_H
+#include <Arduino.h>
+
+#define LIN_MAX_POINTS 32   //measured points stored in the config
+#define LIN_MAX_INPUT 128   //max points lin_build() can take (built in table has 79)
+#define LIN_LUT_SIZE 256    //dense inverse table: game % => position between min and max break voltage
+#define LIN_CURVE_SIZE 512  //gamma and linearization in one table, this is what the output reads
+                            //(< 0.2 bit off the exact pow() curve, gamma 4.0 below 1% load up to 1 bit)
+
+//1 = monotone cubic hermite (Fritsch-Carlson) between the points, no slope kinks at the nodes
+//0 = linear between the points
+#define LIN_MONOTONE_CUBIC 1
+
+//everything here is constexpr: the same code builds the preset tables at compile time
+//(lin_tables.h) and the tables for measured points or custom gammas at runtime
+
+constexpr double lin_sqrt(double x)
+{
+    if (x <= 0.0)
+        return 0.0;
+    double r = x > 1.0 ? x : 1.0;
+    for (int i = 0; i < 40; i++)
+        r = 0.5 * (r + x / r);
+    return r;
+}
+
+//natural log for x > 0: x = m * 2^e, ln(m) with the atanh series
+constexpr double lin_log(double x)
+{
+    int e = 0;
+    while (x >= 1.0)
+    {
+        x *= 0.5;
+        e++;
+    }
+    while (x < 0.5)
+    {
+        x *= 2.0;
+        e--;
+    }
+    double z = (x - 1.0) / (x + 1.0);
+    double z2 = z * z;
+    double term = z;
+    double sum = 0.0;
+    for (int k = 0; k < 40; k++)
+    {
+        sum += term / (2 * k + 1);
+        term *= z2;
+    }
+    return 2.0 * sum + e * 0.69314718055994530942;
+}
+
+//exp for x <= 0 (all we need for p^(1/gamma), p <= 1): exp(x / 256)^256
+constexpr double lin_exp(double x)
+{
+    double y = x / 256.0;
+    double term = 1.0;
+    double sum = 1.0;
+    for (int k = 1; k < 16; k++)
+    {
+        term *= y / k;
+        sum += term;
+    }
+    for (int i = 0; i < 8; i++)
+        sum *= sum;
+    return sum;
+}
+
+//p^(1/gamma) for p in 0.0 - 1.0
+constexpr float lin_gamma(float p, float gamma)
+{
+    if (p <= 0.0f)
+        return 0.0f;
+    if (gamma == 1.0f)
+        return p;
+    return (float)lin_exp(lin_log(p) / gamma);
+}
+
+//O(1) lookup, x 0.0 - 1.0 => table value
+constexpr float lin_lookup(const float *lut, int lut_size, float x)
+{
+    float pos = (x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x)) * (lut_size - 1);
+    int i = (int)pos;
+    if (i >= lut_size - 1)
+        return lut[lut_size - 1];
+    return lut[i] + (pos - i) * (lut[i + 1] - lut[i]);
+}
+
+//span: position of the DAC bit between min_break_volt (0.0) and max_break_volt (1.0), ascending
+//game: break in the game at that position (0.0 - 1.0), made monotone here
+//lut[i] = span what gives the game break i / (lut_size - 1)
+//returns 0 if ok, -1 if the points can not be used
+constexpr int lin_build(const float *span, const float *game, int n, float *lut, int lut_size)
+{
+    if (n < 2 || n > LIN_MAX_INPUT || lut_size < 2)
+        return -1;
+
+    //a measured game % can go back a bit (reading the bar on the TV), keep it monotone
+    //and build the inverse directly: x = game (strictly rising), y = span
+    //of equal game values the first span is used (the break starts there)
+    float x[LIN_MAX_INPUT] = {};
+    float y[LIN_MAX_INPUT] = {};
+    int m = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (i > 0 && span[i] < span[i - 1])
+            return -1;
+        if (m == 0 || game[i] > x[m - 1])
+        {
+            x[m] = game[i];
+            y[m] = span[i];
+            m++;
+        }
+    }
+    if (m < 2)
+        return -1; //flat, no break change at all
+
+    //tangents, Fritsch-Carlson: the curve never overshoots => stays monotone
+    float t[LIN_MAX_INPUT] = {};
+#if LIN_MONOTONE_CUBIC
+    float d[LIN_MAX_INPUT] = {}; //secants
+    for (int k = 0; k < m - 1; k++)
+        d[k] = (y[k + 1] - y[k]) / (x[k + 1] - x[k]);
+
+    t[0] = d[0];
+    t[m - 1] = d[m - 2];
+    for (int k = 1; k < m - 1; k++)
+        t[k] = (d[k - 1] * d[k] <= 0.0f) ? 0.0f : 0.5f * (d[k - 1] + d[k]);
+
+    for (int k = 0; k < m - 1; k++)
+    {
+        if (d[k] == 0.0f)
+        {
+            t[k] = 0.0f;
+            t[k + 1] = 0.0f;
+            continue;
+        }
+        float a = t[k] / d[k];
+        float b = t[k + 1] / d[k];
+        float r = a * a + b * b;
+        if (r > 9.0f)
+        {
+            float tau = (float)(3.0 / lin_sqrt(r));
+            t[k] = tau * a * d[k];
+            t[k + 1] = tau * b * d[k];
+        }
+    }
+#else
+    for (int k = 0; k < m - 1; k++)
+        t[k] = (y[k + 1] - y[k]) / (x[k + 1] - x[k]);
+#endif
+
+    int j = 0;
+    for (int k = 0; k < lut_size; k++)
+    {
+        float p = (float)k / (lut_size - 1);
+
+        if (p <= x[0])
+        {
+            lut[k] = y[0];
+            continue;
+        }
+        if (p >= x[m - 1])
+        {
+            lut[k] = y[m - 1];
+            continue;
+        }
+
+        while (j < m - 2 && x[j + 1] < p)
+            j++;
+
+        float h = x[j + 1] - x[j];
+#if LIN_MONOTONE_CUBIC
+        float s = (p - x[j]) / h;
+        float s2 = s * s;
+        float s3 = s2 * s;
+        lut[k] = (2 * s3 - 3 * s2 + 1) * y[j] + (s3 - 2 * s2 + s) * h * t[j] +
+                 (-2 * s3 + 3 * s2) * y[j + 1] + (s3 - s2) * h * t[j + 1];
+#else
+        lut[k] = y[j] + (p - x[j]) * t[j];
+#endif
+    }
+    return 0;
+}
+
+//gamma and linearization in one table: curve[i] = lut((i / (curve_size - 1))^(1/gamma))
+constexpr void lin_compose(const float *lut, int lut_size, float gamma, float *curve, int curve_size)
+{
+    for (int i = 0; i < curve_size; i++)
+    {
+        curve[i] = lin_lookup(lut, lut_size, lin_gamma((float)i / (curve_size - 1), gamma));
+    }
+}
+
+constexpr bool lin_is_monotone(const float *v, int n)
+{
+    for (int i = 1; i < n; i++)
+    {
+        if (v[i] < v[i - 1])
+            return false;
+    }
+    return true;
+}
+
+#endif
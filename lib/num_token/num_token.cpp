@@ -0,0 +1,214 @@
+#include "num_token.h"
+
+#define NT_IDLE 0
+#define NT_SIGN 1      //'-' or '+', no digit yet
+#define NT_INT 2
+#define NT_DOT 3       //'.', no fraction digit yet
+#define NT_FRAC 4
+#define NT_EXP 5       //'e' after the mantissa
+#define NT_EXP_SIGN 6
+#define NT_EXP_DIGITS 7
+
+#define NT_MANTISSA_MAX 100000000UL //8 digits, more than a float has
+#define NT_EXPONENT_MAX 45
+
+void num_token_reset(num_token_t &nt)
+{
+    nt.value = 0.0f;
+    nt.state = NT_IDLE;
+    nt.in_line = false;
+    nt.eol_pending = false;
+    nt.junk = false;
+    nt.last_ms = 0;
+}
+
+static void token_start(num_token_t &nt, uint8_t state)
+{
+    nt.state = state;
+    nt.negative = false;
+    nt.exp_negative = false;
+    nt.digits = 0;
+    nt.scale = 0;
+    nt.exponent = 0;
+    nt.mantissa = 0;
+}
+
+static void add_digit(num_token_t &nt, char c, bool fraction)
+{
+    if (fraction && nt.scale <= -NT_EXPONENT_MAX)
+    {
+        //zeros after the point beyond the float range
+    }
+    else if (nt.mantissa < NT_MANTISSA_MAX)
+    {
+        nt.mantissa = nt.mantissa * 10 + (c - '0');
+        if (fraction)
+            nt.scale--;
+    }
+    else if (!fraction && nt.scale < NT_EXPONENT_MAX)
+    {
+        nt.scale++; //integer digit beyond the float precision
+    }
+    if (nt.digits < 255)
+        nt.digits++;
+}
+
+//the token ends: NUM_TOKEN_VALUE if it had a digit
+static int token_end(num_token_t &nt)
+{
+    bool number = nt.state != NT_IDLE && nt.digits > 0;
+    nt.state = NT_IDLE;
+    if (!number)
+        return NUM_TOKEN_NONE;
+
+    int e = nt.scale + (nt.exp_negative ? -nt.exponent : nt.exponent);
+    float v = nt.mantissa;
+    for (; e > 0; e--)
+        v *= 10.0f;
+    for (; e < 0; e++)
+        v /= 10.0f;
+    nt.value = nt.negative ? -v : v;
+    return NUM_TOKEN_VALUE;
+}
+
+static bool is_separator(char c)
+{
+    return c == ' ' || c == '\t' || c == ',' || c == ';';
+}
+
+int num_token_feed(num_token_t &nt, char c)
+{
+    if (c == '\n' || c == '\r')
+    {
+        int ev = token_end(nt);
+        if (!nt.in_line)
+            return ev;
+        nt.in_line = false;
+        if (ev == NUM_TOKEN_VALUE)
+        {
+            nt.eol_pending = true;
+            return ev;
+        }
+        return NUM_TOKEN_EOL;
+    }
+    nt.in_line = true;
+
+    bool digit = c >= '0' && c <= '9';
+    switch (nt.state)
+    {
+    case NT_SIGN:
+    case NT_INT:
+        if (digit)
+        {
+            nt.state = NT_INT;
+            add_digit(nt, c, false);
+            return NUM_TOKEN_NONE;
+        }
+        if (c == '.')
+        {
+            nt.state = NT_DOT;
+            return NUM_TOKEN_NONE;
+        }
+        if ((c == 'e' || c == 'E') && nt.digits > 0)
+        {
+            nt.state = NT_EXP;
+            return NUM_TOKEN_NONE;
+        }
+        break;
+    case NT_DOT:
+    case NT_FRAC:
+        if (digit)
+        {
+            nt.state = NT_FRAC;
+            add_digit(nt, c, true);
+            return NUM_TOKEN_NONE;
+        }
+        if ((c == 'e' || c == 'E') && nt.digits > 0)
+        {
+            nt.state = NT_EXP;
+            return NUM_TOKEN_NONE;
+        }
+        break;
+    case NT_EXP:
+    case NT_EXP_SIGN:
+    case NT_EXP_DIGITS:
+        if (digit)
+        {
+            nt.state = NT_EXP_DIGITS;
+            if (nt.exponent < NT_EXPONENT_MAX)
+                nt.exponent = nt.exponent * 10 + (c - '0');
+            return NUM_TOKEN_NONE;
+        }
+        if ((c == '-' || c == '+') && nt.state == NT_EXP)
+        {
+            nt.state = NT_EXP_SIGN;
+            nt.exp_negative = c == '-';
+            return NUM_TOKEN_NONE;
+        }
+        break;
+    }
+
+    //this byte ends the token, it may start the next one
+    int ev = token_end(nt);
+    if (digit)
+    {
+        token_start(nt, NT_INT);
+        add_digit(nt, c, false);
+    }
+    else if (c == '-' || c == '+')
+    {
+        token_start(nt, NT_SIGN);
+        nt.negative = c == '-';
+    }
+    else if (c == '.')
+    {
+        token_start(nt, NT_DOT);
+    }
+    else if (!is_separator(c))
+    {
+        nt.junk = true;
+    }
+    return ev;
+}
+
+int num_token_poll(num_token_t &nt, Stream &io, unsigned long idle_ms)
+{
+    if (nt.eol_pending)
+    {
+        nt.eol_pending = false;
+        return NUM_TOKEN_EOL;
+    }
+
+    while (io.available() > 0)
+    {
+        int c = io.read();
+        if (c < 0)
+            break;
+        nt.last_ms = millis();
+        int ev = num_token_feed(nt, (char)c);
+        if (ev != NUM_TOKEN_NONE)
+            return ev;
+    }
+
+    if (idle_ms != 0 && nt.in_line && millis() - nt.last_ms > idle_ms)
+        return num_token_feed(nt, '\n'); //a terminal without line end
+    return NUM_TOKEN_NONE;
+}
+
+bool num_parse(const char *text, float &value)
+{
+    num_token_t nt;
+    num_token_reset(nt);
+    int values = 0;
+    for (const char *p = text;; p++)
+    {
+        if (num_token_feed(nt, *p != 0 ? *p : '\n') == NUM_TOKEN_VALUE)
+        {
+            values++;
+            value = nt.value;
+        }
+        if (*p == 0)
+            break;
+    }
+    return values == 1 && !nt.junk;
+}
@@ -0,0 +1,41 @@
+#ifndef NUM_TOKEN_H
+#define NUM_TOKEN_H
+#include <Arduino.h>
+
+#define NUM_TOKEN_IDLE_MS 1000 //a line without '\n' ends after this pause, the same as the Stream timeout of parseFloat()
+
+//events of num_token_feed() and num_token_poll()
+#define NUM_TOKEN_NONE 0  //nothing complete, every byte there is used
+#define NUM_TOKEN_VALUE 1 //nt.value holds the next number
+#define NUM_TOKEN_EOL 2   //end of a line with something in it, after its last value
+
+//numbers in a byte stream, one byte at a time: no buffer, no String, no waiting
+//"-1", "1234.5", ".5", "2e3", separated by anything what is not a number
+struct num_token_t
+{
+    float value;             //last complete number
+    uint8_t state;
+    bool negative;
+    bool exp_negative;
+    bool in_line;            //a byte since the last line end
+    bool eol_pending;        //line end right after a number, reported with the next call
+    bool junk;               //a byte what is neither number nor separator (space , ; tab) since the reset
+    uint8_t digits;          //mantissa digits
+    int8_t scale;            //power of ten of the mantissa (fraction digits negative, dropped integer digits positive)
+    int16_t exponent;
+    uint32_t mantissa;
+    unsigned long last_ms;   //millis() of the last byte from the stream
+};
+
+void num_token_reset(num_token_t &nt);
+
+//one byte, returns an event
+int num_token_feed(num_token_t &nt, char c);
+
+//all bytes available on the stream until the first event, idle_ms 0 = only '\n' or '\r' ends a line
+int num_token_poll(num_token_t &nt, Stream &io, unsigned long idle_ms);
+
+//text with exactly one number and nothing else (spaces are fine), false otherwise
+bool num_parse(const char *text, float &value);
+
+#endif
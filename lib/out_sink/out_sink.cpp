@@ -0,0 +1,149 @@
+#include "out_sink.h"
+
+void out_sink_init(out_sink_t &sk, const char *name, Print &io, uint8_t *buf, size_t size)
+{
+    sk.name = name;
+    sk.io = &io;
+    sk.buf = buf;
+    sk.size = size;
+    sk.head = 0;
+    sk.tail = 0;
+    sk.attached = true;
+    sk.bytes = 0;
+    sk.dropped = 0;
+    sk.dropped_bytes = 0;
+    sk.high_water = 0;
+    portMUX_INITIALIZE(&sk.mux);
+    sk.io_lock = xSemaphoreCreateMutexStatic(&sk.io_lock_buf);
+    sk.drain_task = NULL;
+}
+
+size_t out_sink_used(const out_sink_t &sk)
+{
+    size_t head = sk.head, tail = sk.tail;
+    return head >= tail ? head - tail : sk.size - tail + head;
+}
+
+//one byte of the ring stays free, head == tail is empty
+static bool push_once(out_sink_t &sk, const uint8_t *data, size_t len, bool &was_empty)
+{
+    bool done = false;
+    portENTER_CRITICAL(&sk.mux);
+    size_t used = out_sink_used(sk);
+    if (len < sk.size - used)
+    {
+        size_t head = sk.head;
+        size_t first = sk.size - head < len ? sk.size - head : len;
+        memcpy(sk.buf + head, data, first);
+        memcpy(sk.buf, data + first, len - first);
+        sk.head = (head + len) % sk.size;
+        was_empty = used == 0;
+        if (used + len > sk.high_water)
+            sk.high_water = used + len;
+        done = true;
+    }
+    portEXIT_CRITICAL(&sk.mux);
+    return done;
+}
+
+bool out_sink_push(out_sink_t &sk, const uint8_t *data, size_t len, unsigned long wait_ms)
+{
+    bool was_empty = false;
+    unsigned long start = millis();
+    while (!push_once(sk, data, len, was_empty))
+    {
+        if (len >= sk.size || millis() - start >= wait_ms)
+        {
+            sk.dropped++;
+            sk.dropped_bytes += len;
+            return false;
+        }
+        vTaskDelay(1);
+    }
+    if (was_empty && sk.drain_task != NULL)
+        xTaskNotifyGive(sk.drain_task);
+    return true;
+}
+
+void out_sink_drain(out_sink_t &sk)
+{
+    while (out_sink_used(sk) > 0)
+    {
+        size_t tail = sk.tail, head = sk.head;
+        size_t n = head > tail ? head - tail : sk.size - tail; //contiguous part
+        if (n > OUT_CHUNK)
+            n = OUT_CHUNK;
+
+        xSemaphoreTake(sk.io_lock, portMAX_DELAY);
+        sk.io->write(sk.buf + tail, n); //may block on a slow transport, only this task waits
+        xSemaphoreGive(sk.io_lock);
+
+        sk.tail = (tail + n) % sk.size;
+        sk.bytes += n;
+    }
+}
+
+void out_sink_discard(out_sink_t &sk)
+{
+    sk.tail = sk.head;
+}
+
+bool out_sink_flush(out_sink_t &sk, unsigned long wait_ms)
+{
+    unsigned long start = millis();
+    while (out_sink_used(sk) > 0 && millis() - start < wait_ms)
+        vTaskDelay(1);
+    return out_sink_used(sk) == 0;
+}
+
+void out_sink_io_take(out_sink_t &sk)
+{
+    xSemaphoreTake(sk.io_lock, portMAX_DELAY);
+}
+
+void out_sink_io_give(out_sink_t &sk)
+{
+    xSemaphoreGive(sk.io_lock);
+}
+
+OutFanout::OutFanout() : count(0), waiter(NULL), wait_ms(0)
+{
+}
+
+void OutFanout::add(out_sink_t &sk)
+{
+    if (count < OUT_SINK_MAX)
+        sinks[count++] = &sk;
+}
+
+void OutFanout::attach(out_sink_t &sk)
+{
+    sk.attached = true;
+}
+
+void OutFanout::detach(out_sink_t &sk)
+{
+    sk.attached = false;
+}
+
+void OutFanout::wait_task(TaskHandle_t task, unsigned long ms)
+{
+    waiter = task;
+    wait_ms = ms;
+}
+
+size_t OutFanout::write(uint8_t c)
+{
+    return write(&c, 1);
+}
+
+size_t OutFanout::write(const uint8_t *buffer, size_t size)
+{
+    unsigned long wait = (waiter != NULL && xTaskGetCurrentTaskHandle() == waiter) ? wait_ms : 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (sinks[i]->attached)
+            out_sink_push(*sinks[i], buffer, size, wait);
+    }
+    return size; //a dropped print is counted in its sink, not an error of the caller
+}
@@ -0,0 +1,80 @@
+#ifndef OUT_SINK_H
+#define OUT_SINK_H
+#include <Arduino.h>
+
+//build mode without any text output: print_serial_and_bt() compiles to nothing, the drain tasks and their stacks
+//are not created and the sink buffers are small (env:lolin32_quiet), the command replies still go out
+#ifndef OUT_NULL
+#define OUT_NULL 0
+#endif
+
+#define OUT_SINK_MAX 4   //sinks of one fan-out
+#define OUT_DRAIN_MS 20  //a drain task wakes at least this often
+#define OUT_CHUNK 128    //bytes per write to the transport
+
+//one transport (Serial, SerialBT) behind a ring buffer: the printing task only copies,
+//the drain task of the sink does the slow write, a full buffer drops the whole print
+struct out_sink_t
+{
+    const char *name;
+    Print *io;
+    uint8_t *buf;
+    size_t size;
+    volatile size_t head;                 //next byte to write, moved by the producers
+    volatile size_t tail;                 //next byte to send, moved by the drain task
+    volatile bool attached;               //false = prints are not taken, the rest is still sent
+    volatile unsigned long bytes;         //bytes given to the transport
+    volatile unsigned long dropped;       //prints dropped, the buffer was full
+    volatile unsigned long dropped_bytes;
+    size_t high_water;                    //most bytes buffered
+    portMUX_TYPE mux;                     //producers on both cores, held only for the copy
+    SemaphoreHandle_t io_lock;            //the transport: one drain chunk or a direct reply
+    StaticSemaphore_t io_lock_buf;
+    TaskHandle_t drain_task;              //woken when a print goes into an empty buffer
+};
+
+//buf with size bytes is the ring, the sink starts attached
+void out_sink_init(out_sink_t &sk, const char *name, Print &io, uint8_t *buf, size_t size);
+
+//bytes waiting for the transport
+size_t out_sink_used(const out_sink_t &sk);
+
+//copy all of data or nothing, waits up to wait_ms for room (0 = drop at once), false if dropped
+bool out_sink_push(out_sink_t &sk, const uint8_t *data, size_t len, unsigned long wait_ms);
+
+//send what is buffered, call it from the drain task of the sink only
+void out_sink_drain(out_sink_t &sk);
+
+//forget what is buffered (transport off), not counted as dropped
+void out_sink_discard(out_sink_t &sk);
+
+//wait up to wait_ms until the buffer is sent, true if it is empty
+bool out_sink_flush(out_sink_t &sk, unsigned long wait_ms);
+
+//direct write to the transport between two drain chunks (binary replies)
+void out_sink_io_take(out_sink_t &sk);
+void out_sink_io_give(out_sink_t &sk);
+
+//Print what gives every print to all attached sinks
+class OutFanout : public Print
+{
+public:
+    OutFanout();
+
+    void add(out_sink_t &sk);                                  //setup(), before the first print
+    void attach(out_sink_t &sk);                               //at runtime
+    void detach(out_sink_t &sk);
+    void wait_task(TaskHandle_t task, unsigned long wait_ms); //this task (the wizards) waits for room, all others drop
+
+    size_t write(uint8_t c);
+    size_t write(const uint8_t *buffer, size_t size);
+    using Print::write;
+
+private:
+    out_sink_t *sinks[OUT_SINK_MAX];
+    int count;
+    TaskHandle_t waiter;
+    unsigned long wait_ms;
+};
+
+#endif
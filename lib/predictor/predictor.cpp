@@ -0,0 +1,27 @@
+#include "predictor.h"
+
+void predictor_reset(predictor_t &pd)
+{
+    pd.x = 0.0f;
+    pd.v = 0.0f;
+    pd.init = false;
+}
+
+float predictor_update(predictor_t &pd, float load, float dt, float delay, float max_load)
+{
+    if (!pd.init || dt <= 0.0f)
+    {
+        pd.x = load;
+        pd.v = 0.0f;
+        pd.init = true;
+        return load > max_load ? max_load : load;
+    }
+
+    float x_pred = pd.x + pd.v * dt;
+    float r = load - x_pred;
+    pd.x = x_pred + PRED_ALPHA * r;
+    pd.v += PRED_BETA * r / dt;
+
+    float out = pd.x + pd.v * delay;
+    return out > max_load ? max_load : out;
+}
@@ -0,0 +1,23 @@
+#ifndef PREDICTOR_H
+#define PREDICTOR_H
+#include <math.h> //no Arduino.h, tools/filter_bench builds this on the PC
+
+#define PRED_ALPHA 0.8f //alpha-beta tracker gains: level
+#define PRED_BETA 0.3f  //and rate, smaller = less noise in the rate, slower on a change
+
+//alpha-beta tracker on the filtered load: level and rate
+//the output is the level extrapolated over the group delay of the filter in front
+struct predictor_t
+{
+    float x;   //level
+    float v;   //rate per s
+    bool init; //x and v valid
+};
+
+void predictor_reset(predictor_t &pd);
+
+//load = filtered load, dt = time since the last sample, delay = group delay of the filter (all in s)
+//the prediction is clamped to max_load, never more break than the 100% point
+float predictor_update(predictor_t &pd, float load, float dt, float delay, float max_load);
+
+#endif
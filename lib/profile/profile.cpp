@@ -0,0 +1,127 @@
+#include "profile.h"
+#include "lin_tables.h"
+#include <HX711_ADC.h> //SAMPLES
+
+bool profile_used(const brake_profile_t &p)
+{
+    return p.name[0] != 0;
+}
+
+bool profile_sane(const brake_profile_t &p)
+{
+    if (!isfinite(p.max_break) || !isfinite(p.min_break) || p.min_break >= p.max_break)
+        return false;
+    if (!(p.max_break_redfac > 0.0f && p.max_break_redfac <= 100.0f))
+        return false;
+    if (p.max_break_volt < 0 || p.max_break_volt > 255 || p.min_break_volt < 0 || p.min_break_volt > 255)
+        return false;
+    if (!(p.gammafac >= 0.25f && p.gammafac <= 4.0f))
+        return false;
+    if (p.filter_samples < 1 || p.filter_samples > SAMPLES)
+        return false;
+    if (p.lin_points != 0 && (p.lin_points < 2 || p.lin_points > LIN_MAX_POINTS))
+        return false;
+    for (int i = 0; i < p.lin_points; i++)
+    {
+        if (!(p.lin_span[i] >= 0.0f && p.lin_span[i] <= 1.0f && p.lin_game[i] >= 0.0f && p.lin_game[i] <= 1.0f))
+            return false;
+    }
+    return true;
+}
+
+bool curve_sane(const brake_curve_t &c)
+{
+    if (c.points != 0 && (c.points < 2 || c.points > CURVE_MAX_POINTS))
+        return false;
+    for (int i = 0; i < c.points; i++)
+    {
+        if (!(c.load[i] >= 0.0f && c.load[i] <= 1.0f && c.brake[i] >= 0.0f && c.brake[i] <= 1.0f))
+            return false;
+        if (i > 0 && (c.load[i] <= c.load[i - 1] || c.brake[i] < c.brake[i - 1]))
+            return false;
+    }
+    return true;
+}
+
+int curve_from_bezier(brake_curve_t &c, float x1, float y1, float x2, float y2)
+{
+    brake_curve_t temp;
+    temp.points = CURVE_MAX_POINTS;
+    for (int k = 0; k < CURVE_MAX_POINTS; k++)
+    {
+        float t = (float)k / (CURVE_MAX_POINTS - 1);
+        float u = 1.0f - t;
+        float b1 = 3 * u * u * t;
+        float b2 = 3 * u * t * t;
+        float b3 = t * t * t;
+        temp.load[k] = b1 * x1 + b2 * x2 + b3;
+        temp.brake[k] = b1 * y1 + b2 * y2 + b3;
+    }
+    if (!curve_sane(temp))
+        return -1;
+    c = temp;
+    return 0;
+}
+
+int profile_compile(const brake_profile_t &p, const brake_curve_t &c, profile_runtime_t &rt, float *curve_ram)
+{
+    rt.max_break = p.max_break;
+    rt.min_break = p.min_break;
+    rt.max_break_redfac = p.max_break_redfac;
+    rt.max_break_volt = p.max_break_volt;
+    rt.min_break_volt = p.min_break_volt;
+    rt.volt_direction_normal = p.max_break_volt > p.min_break_volt;
+
+    //end zones 0.0001 / 0.9999 after the gamma
+    rt.lower_delta = powf(0.0001f, p.gammafac);
+    rt.upper_delta = powf(0.9999f, p.gammafac);
+
+    //built in points and a preset gamma => table in flash
+    int preset = lin_preset_find(p.gammafac);
+    if (p.lin_points < 2 && c.points == 0 && preset >= 0)
+    {
+        rt.curve = lin_preset_curve[preset].v;
+        return 0;
+    }
+
+    //packed struct, copy the points before taking pointers
+    float span[LIN_MAX_POINTS];
+    float game[LIN_MAX_POINTS];
+    memcpy(span, p.lin_span, sizeof(span));
+    memcpy(game, p.lin_game, sizeof(game));
+
+    float lut[LIN_LUT_SIZE];
+    if (p.lin_points < 2 || lin_build(span, game, p.lin_points, lut, LIN_LUT_SIZE) != 0)
+    {
+        lin_build(lin_builtin.span, lin_builtin.game, LOAD_PERCENT_STEPS, lut, LIN_LUT_SIZE);
+    }
+
+    //force curve: load => break in the game, then the linearization, still one table for the output
+    //the shape is built in curve_ram and then mapped through the linearization in place
+    int result = 0;
+    if (c.points >= 2)
+    {
+        memcpy(span, c.brake, sizeof(float) * c.points);
+        memcpy(game, c.load, sizeof(float) * c.points);
+        if (lin_build(span, game, c.points, curve_ram, LIN_CURVE_SIZE) == 0)
+        {
+            for (int i = 0; i < LIN_CURVE_SIZE; i++)
+            {
+                curve_ram[i] = lin_lookup(lut, LIN_LUT_SIZE, curve_ram[i]);
+            }
+            rt.lower_delta = 0.0001f;
+            rt.upper_delta = 0.9999f;
+            rt.curve = curve_ram;
+            return 0;
+        }
+        result = -1;
+    }
+
+    //same as lin_compose() but with powf(), lin_gamma() is the slow compile time version
+    for (int i = 0; i < LIN_CURVE_SIZE; i++)
+    {
+        curve_ram[i] = lin_lookup(lut, LIN_LUT_SIZE, powf((float)i / (LIN_CURVE_SIZE - 1), 1.0f / p.gammafac));
+    }
+    rt.curve = curve_ram;
+    return result;
+}
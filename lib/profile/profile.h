@@ -0,0 +1,64 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+#include <Arduino.h>
+#include "linearization.h"
+
+#define PROFILE_MAX 4       //profiles stored in the config
+#define PROFILE_NAME_LEN 12 //including the 0 at the end
+#define CURVE_MAX_POINTS 16 //control points of a user force curve
+
+//everything what changes between games (GTSport 221/149, ACC 222/114, ...)
+struct __attribute__((packed)) brake_profile_t
+{
+    char name[PROFILE_NAME_LEN];     //"" = slot not used
+    float max_break;                 //100% break load
+    float min_break;                 //dead zone load
+    float max_break_redfac;          //max break reduction in %
+    int32_t max_break_volt;          //DAC bit for 100% break
+    int32_t min_break_volt;          //DAC bit for 0% break
+    float gammafac;                  //gamma of the break curve
+    int32_t filter_samples;          //HX711 moving average depth, 1 - SAMPLES
+    int32_t lin_points;              //measured game linearization points, 0 = built in load_percent[]
+    float lin_span[LIN_MAX_POINTS];
+    float lin_game[LIN_MAX_POINTS];
+};
+
+//user force curve of a profile, replaces the gamma
+//monotone cubic through the points, outside the first/last point the break stays at that value
+struct __attribute__((packed)) brake_curve_t
+{
+    int32_t points;                //0 = gamma curve
+    float load[CURVE_MAX_POINTS];  //load 0.0 - 1.0, rising
+    float brake[CURVE_MAX_POINTS]; //break 0.0 - 1.0 what the game should get, not falling
+};
+
+//a profile compiled for the output: what one sample needs, nothing to calculate
+struct profile_runtime_t
+{
+    float max_break;
+    float min_break;
+    float max_break_redfac;
+    int max_break_volt;
+    int min_break_volt;
+    bool volt_direction_normal; //0% to 100% break goes from low to high voltage
+    float lower_delta;          //end zones in load % before the gamma / force curve
+    float upper_delta;
+    const float *curve;         //LIN_CURVE_SIZE values, preset in flash or the curve_ram given to profile_compile()
+};
+
+bool profile_used(const brake_profile_t &p);
+
+//range check of the values, CRC or not
+bool profile_sane(const brake_profile_t &p);
+
+bool curve_sane(const brake_curve_t &c);
+
+//cubic bezier from (0,0) to (1,1) with the control points (x1,y1) and (x2,y2), sampled into c
+//returns -1 if the curve is not monotone
+int curve_from_bezier(brake_curve_t &c, float x1, float y1, float x2, float y2);
+
+//curve_ram (LIN_CURVE_SIZE floats) is only written if no preset table fits
+//returns -1 if the force curve can not be used, rt is then built with the gamma
+int profile_compile(const brake_profile_t &p, const brake_curve_t &c, profile_runtime_t &rt, float *curve_ram);
+
+#endif
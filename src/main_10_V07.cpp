@@ -24,22 +24,157 @@
 #include "string2char.h"    //convert string to char
 #include "bit_check_band.h" //check if a value is within the min max if lower=min, if over=max
 #include "mapping.h"        //map a input value to a new range out
+#include "config_store.h"   //versioned, CRC checked config in NVS (A/B slots)
+#include "auto_zero.h"      //slow zero tracking while the pedal is idle
+#include "creep.h"          //load cell creep compensation
+#include "calibration_fit.h" //multi point least squares calibration
+#include "linearization.h"  //game break % => DAC bit, dense inverse table
+#include "profile.h"        //per game break profiles, compiled for the output
+#include "adaptive_filter.h" //raw data on the break onset, average while holding
+#include "predictor.h"      //group delay compensation of the load filter
+#include "dac_interp.h"     //DAC output ramp between two samples
+#include "heap_guard.h"     //static allocation mode, heap use after setup() is counted
+#include "bt_link.h"        //Bluetooth started on demand, off when idle
+#include "jitter_hist.h"    //wake latency and output period histograms
+#include "cmd_line.h"       //command lines and key=value batches from Serial and BT
+#include "num_token.h"      //numbers typed in the wizards, without waiting on the stream
+#include "out_sink.h"       //text output through a buffer and a drain task per transport
 
 // external libaries
 #include <HX711_ADC.h> // the libary for the HX711
-#include <EEPROM.h>    //Libary for the EEPROM Memory
 #include <BluetoothSerial.h>
 
 #if !defined(CONFIG_BT_ENABLED) || !defined(CONFIG_BLUEDROID_ENABLED)
 #error Bluetooth is not enabled! Please run `make menuconfig` to and enable it
 #endif
 
-BluetoothSerial SerialBT;
+BtLink SerialBT("ESP32_G29_BreakSys"); //Bluetooth device name, started with 'b' or the boot button
+
+#define BT_AT_BOOT 0            //1 = BT on from the start as before (off again after BT_IDLE_MS)
+#define BT_BUTTON 0             //boot button of the lolin32
+#define BT_BUTTON_HOLD_MS 2000  //hold it that long to start BT
+
+//text output: every transport has its own buffer and drain task, a stalled BT peer does not hold up the USB console
+#if OUT_NULL
+#define OUT_BUF_SERIAL 16 //nothing is buffered, the sinks only lock the direct replies
+#define OUT_BUF_BT 16
+#else
+#define OUT_BUF_SERIAL 2048
+#define OUT_BUF_BT 2048
+#endif
+#define OUT_WAIT_MS 200        //setup() and the command task (wizards, reports) wait this long for room, the other tasks drop
+#define OUT_REPLY_FLUSH_MS 500 //a direct reply waits for the text before it
+uint8_t out_buf_serial[OUT_BUF_SERIAL];
+uint8_t out_buf_bt[OUT_BUF_BT];
+out_sink_t serial_sink;
+out_sink_t bt_sink;
+OutFanout out; //print_serial_and_bt() writes here
 
 TaskHandle_t Task0;
+TaskHandle_t TaskAcquire;  //HX711 to DAC target, woken by the DOUT interrupt
+TaskHandle_t TaskCommands; //serial/BT commands and wizards
+TaskHandle_t TaskTelemetry; //'s' data print
+TaskHandle_t TaskOutSerial; //drain of serial_sink
+TaskHandle_t TaskOutBT;     //drain of bt_sink
 //TaskHandle_t Task1;
 //QueueHandle_t queue;
 SemaphoreHandle_t Semaphore;
+SemaphoreHandle_t Acquire; //held by the acquisition task for one sample
+
+#define ACQ_POLL_MS 100     //acquisition without a DOUT edge (no HX711, after a pause)
+#define COMMAND_PERIOD_MS 5 //command task polls the serial/BT input
+
+volatile bool acquire_paused = false; //a wizard uses the load cell, the acquisition task waits
+volatile bool tare_done = false;      //tare finished in the acquisition task, saved by the command task
+
+#define TASK_ACQUIRE 0   //HX711 read and the processing up to the DAC target, woken by the DOUT interrupt
+#define TASK_OUTPUT 1    //pwm2dac, never blocks
+#define TASK_TELEMETRY 2 //'s' data print, off the sample path
+#define TASK_COMMANDS 3  //serial/BT commands and wizards
+#define TASK_OUT_SERIAL 4 //text output to Serial
+#define TASK_OUT_BT 5     //text output to SerialBT, may block on the BT stack
+#define TASK_COUNT 6
+#define TASK_STATUS_MAX 24      //FreeRTOS tasks in the 'u' report (ours, BT, WiFi, idle, timer)
+#define TELEMETRY_PERIOD_MS 1000 //increase value to slow down serial print activity
+
+volatile unsigned long task_wakes[TASK_COUNT]; //the task did block and run again (voluntary context switches)
+
+//timing with and without BT, 'j' prints and resets them (written by the tasks without a lock, statistics only)
+jitter_hist_t wake_hist;   //DOUT interrupt => acquisition task running
+jitter_hist_t output_hist; //one pwm2dac loop (dither block) to the next
+volatile unsigned long dout_isr_us = 0; //micros() of the last DOUT interrupt, 0 = used
+
+//last sample for the telemetry task, written with the DAC target
+struct telemetry_t
+{
+    long count;
+    float loadcellraw;
+    float out; //GLED or lower bit
+    int normal;
+    float gammafac;
+    float weight_in_percent;
+    int outputtype;
+};
+telemetry_t telemetry_snap;
+
+//task map: where each task runs, change a task here (stack in bytes, as xTaskCreatePinnedToCore takes it)
+//the processing of a sample stays in the acquisition task, a hand over would cost a switch per sample
+struct task_map_t
+{
+    const char *name;
+    uint32_t stack;
+    UBaseType_t priority;
+    BaseType_t core;
+    TaskHandle_t *handle;
+    StackType_t *stack_buf; //STATIC_ALLOC: the stack in static memory, else NULL
+};
+
+#define STACK_ACQUIRE 4096
+#define STACK_OUTPUT 4096
+#define STACK_TELEMETRY 3072
+#define STACK_COMMANDS 8192
+#define STACK_OUT_SERIAL 2048
+#define STACK_OUT_BT 3072
+
+#if STATIC_ALLOC
+StackType_t stack_acquire[STACK_ACQUIRE];
+StackType_t stack_output[STACK_OUTPUT];
+StackType_t stack_telemetry[STACK_TELEMETRY];
+StackType_t stack_commands[STACK_COMMANDS];
+#if !OUT_NULL
+StackType_t stack_out_serial[STACK_OUT_SERIAL];
+StackType_t stack_out_bt[STACK_OUT_BT];
+#endif
+StaticTask_t task_tcb[TASK_COUNT];
+StaticSemaphore_t semaphore_buf;
+StaticSemaphore_t acquire_buf;
+#define TASK_STACK(buf) buf
+#else
+#define TASK_STACK(buf) NULL
+#endif
+
+#if OUT_NULL
+#define OUT_TASK_STACK(buf) NULL //no drain tasks, no stacks
+#else
+#define OUT_TASK_STACK(buf) TASK_STACK(buf)
+#endif
+
+const task_map_t task_map[TASK_COUNT] = {
+    {"Acquire", STACK_ACQUIRE, 2, 1, &TaskAcquire, TASK_STACK(stack_acquire)},
+    {"Task0", STACK_OUTPUT, 1, 1, &Task0, TASK_STACK(stack_output)},
+    {"Telemetry", STACK_TELEMETRY, 1, 0, &TaskTelemetry, TASK_STACK(stack_telemetry)}, //with the BT stack, it prints mostly to BT
+    {"Commands", STACK_COMMANDS, 1, 1, &TaskCommands, TASK_STACK(stack_commands)},     //the wizards need more stack
+    {"OutSerial", STACK_OUT_SERIAL, 1, 0, &TaskOutSerial, OUT_TASK_STACK(stack_out_serial)},
+    {"OutBT", STACK_OUT_BT, 1, 0, &TaskOutBT, OUT_TASK_STACK(stack_out_bt)},
+};
+
+//command lines, the same parser for both streams
+cmd_source_t serial_cmd;
+cmd_source_t bt_cmd;
+
+//numbers typed in the wizards, one tokenizer for each stream
+num_token_t serial_num;
+num_token_t bt_num;
 
 //pins:
 const int HX711_dout = 27; //mcu > HX711 dout pin
@@ -51,14 +186,13 @@ const int HX711_sck = 14;  //mcu > HX711 sck pin
 //HX711 constructor:
 HX711_ADC LoadCell(HX711_dout, HX711_sck);
 
-const int calVal_eepromAdress = 0;
 long t;
 
 long t_simulate;
 int flag_init_time = 1; //1=true
 int case_counter = 0;
 
-String ino = __FILE__; //file name
+char ino[32] = ""; //file name without path and extension, set in setup()
 
 bool volt_direction_normal = false; // break 0-100% voltage low-hight = true
 
@@ -86,6 +220,10 @@ float esp32Volt = 3.3;
 float ref_voltage = (1.0 / 255.0) * esp32Volt;
 
 float newCalibrationValue = 1.23f;
+float cal_offset = 0.0f; //multi point calibration offset (after getData())
+float cal_quad = 0.0f;   //multi point calibration quadratic term
+
+#define CAL_AVG_SAMPLES 32 //conversions averaged for one calibration point
 
 float kg_factor = 1000.0f;
 
@@ -96,43 +234,219 @@ bool reboot_esp32 = false;
 int simulant_case = 0; //no simulation just the load cell, Sinus curve = 1, na=2, na=3
 
 float gammafac = 1.0; //linear
-int laod_percent_steps = 79;
-float load_percent[79] = {1.0, 0.963, 0.93, 0.895, 0.86, 0.835, 0.804, 0.776, 0.749, 0.725,
-                          0.701, 0.68, 0.66, 0.642, 0.625, 0.609, 0.595, 0.58, 0.564, 0.55,
-                          0.535, 0.525, 0.512, 0.498, 0.485, 0.475, 0.462, 0.455, 0.447, 0.439,
-                          0.431, 0.423, 0.416, 0.408, 0.4, 0.392, 0.384, 0.377, 0.369, 0.361,
-                          0.353, 0.345, 0.337, 0.33, 0.322, 0.314, 0.306, 0.298, 0.291, 0.283,
-                          0.275, 0.267, 0.259, 0.252, 0.247, 0.236, 0.228, 0.220, 0.212, 0.205,
-                          0.197, 0.189, 0.181, 0.173, 0.166, 0.158, 0.15, 0.142, 0.134, 0.127,
-                          0.116, 0.105, 0.094, 0.078, 0.063, 0.047, 0.031, 0.016, 0.0};
+
+float creep_amplitude = 0.0f; //creep of the load cell as fraction, 0 = no compensation
+float creep_tau = 5.0f;       //creep time constant in s
+//measured with the 'g' command, replaces load_percent[] (lin_tables.h) if lin_points > 0
+int lin_points = 0;
+float lin_span[LIN_MAX_POINTS];
+float lin_game[LIN_MAX_POINTS];
+
+int filter_samples = SAMPLES; //HX711 moving average depth at RATE_REF_SPS
+int filter_mode = 0;          //0 = HX711 moving average, 1 = adaptive filter with filter_samples as max window
+int predict_on = 0;           //1 = extrapolate the filtered load over the filter delay
+
+//the sample counts are tuned at the speed of my hx711, with the measured rate the
+//same times are used on a 10 SPS or 80 SPS board
+#define RATE_REF_SPS 89.0f  //not 80 but 89 is my speed
+#define RATE_CHANGE 0.1f    //derive the timing again after a rate change of 10%
+#define DITHER_BLOCK 10     //DAC writes of one dither block at RATE_REF_SPS
+#define DITHER_BLOCK_MAX 80 //longer holds of one value get a finer dither, up to this
+#define DAC_INTERP_FAC 1.0f //DAC ramp to a new target over this part of a conversion, 0 = steps as before
+float rate_sps = RATE_REF_SPS;       //measured rate the timing is derived for
+float rate_dt = 1.0f / RATE_REF_SPS; //one conversion in s
+int dither_block = DITHER_BLOCK;
+
+//the RAM break variables are the active profile, the others are only in flash_cfg.profiles[]
+int active_profile = 0;
+
+//compiled profiles for the output, one buffer more than profiles:
+//a profile is compiled into the spare buffer and then swapped in, never changed while in use
+profile_runtime_t profile_rt[PROFILE_MAX + 1];
+float profile_curve_ram[PROFILE_MAX + 1][LIN_CURVE_SIZE];
+int profile_buf[PROFILE_MAX] = {0, 1, 2, 3}; //buffer of each profile
+int profile_spare = PROFILE_MAX;
+static_assert(PROFILE_MAX == 4, "update profile_buf[]");
+
+//read once per sample, switching the profile is this one pointer
+profile_runtime_t *volatile profile_active = &profile_rt[0];
 
 float rad = 0.0; //zero angle
 
 int normal = 1; // 2 = use input as output (raw with oth load_percen array), 0 = in voltage
 
+//what is stored in flash, also holds the saved tare what is not a RAM variable
+brake_config_t flash_cfg;
+
+auto_zero_t autozero; //drift tracking of the tare offset
+creep_t creep;        //creep compensation state
+adaptive_filter_t afilter;
+predictor_t predictor;
+
 // Global variables, available to all
-static volatile unsigned int lowerbitcase;
-static volatile unsigned int upperbitcase;
-static volatile unsigned int lower2pwm;
-static volatile unsigned int upper2pwm;
+static volatile float dac_target_global; //DAC bit with fraction, pwm2dac ramps to it and dithers
 static volatile bool open2use = false;
-static volatile unsigned long count = 0;
+static volatile uint32_t published_seq = 0; //sequence number of the sample in the globals above
+
+//handoff acquisition => pwm2dac, each counter has one writer (statistics, read without a lock)
+struct handoff_stats_t
+{
+    volatile uint32_t produced;    //samples published, the last one has this sequence number
+    volatile uint32_t consumed;    //samples taken by the output task
+    volatile uint32_t overwritten; //published and replaced before the output task took them
+    volatile uint32_t stale;       //output blocks without a new sample, the last one again (normal: the output is faster)
+};
+handoff_stats_t handoff = {0, 0, 0, 0};
 static volatile int normalization = 1;
 static volatile float GLED_global;
-static volatile int dac_case_global;
 
-void print_serial_and_bt(String text2print, int newlineornot)
+//the prints only copy into the sink buffers, the drain tasks write to Serial and BT
+//no String (no heap): literals and names, numbers with print_num_serial_and_bt()
+void print_serial_and_bt(const char *text2print, int newlineornot)
 {
+#if !OUT_NULL
     if (newlineornot == 0)
     {
-        Serial.print(text2print);
-        SerialBT.print(text2print);
+        out.print(text2print);
+    }
+    if (newlineornot == 1)
+    {
+        out.println(text2print);
+    }
+#endif
+}
+
+//numbers without a String
+void print_num_serial_and_bt(double value, int digits, int newlineornot)
+{
+#if !OUT_NULL
+    out.print(value, digits);
+    if (newlineornot == 1)
+    {
+        out.println();
     }
+#endif
+}
+
+void print_num_serial_and_bt(long value, int newlineornot)
+{
+#if !OUT_NULL
+    out.print(value);
     if (newlineornot == 1)
     {
-        Serial.println(text2print);
-        SerialBT.println(text2print);
+        out.println();
+    }
+#endif
+}
+
+//copy the RAM break variables into a profile, the name stays
+void profile_from_ram(brake_profile_t &p)
+{
+    p.max_break = max_break;
+    p.min_break = min_break;
+    p.max_break_redfac = max_break_redfac;
+    p.max_break_volt = max_break_volt;
+    p.min_break_volt = min_break_volt;
+    p.gammafac = gammafac;
+    p.filter_samples = filter_samples;
+    p.lin_points = lin_points;
+    memcpy(p.lin_span, lin_span, sizeof(lin_span));
+    memcpy(p.lin_game, lin_game, sizeof(lin_game));
+}
+
+//copy a profile into the RAM break variables
+void profile_to_ram(const brake_profile_t &p)
+{
+    max_break = p.max_break;
+    min_break = p.min_break;
+    max_break_redfac = p.max_break_redfac;
+    max_break_volt = p.max_break_volt;
+    min_break_volt = p.min_break_volt;
+    gammafac = p.gammafac;
+    filter_samples = p.filter_samples;
+    lin_points = p.lin_points;
+    memcpy(lin_span, p.lin_span, sizeof(lin_span));
+    memcpy(lin_game, p.lin_game, sizeof(lin_game));
+}
+
+//filter window at the measured rate: the same time as filter_samples at RATE_REF_SPS
+int filter_window()
+{
+    int n = int(filter_samples * rate_sps / RATE_REF_SPS + 0.5f);
+    return constrain(n, 1, SAMPLES);
+}
+
+//HX711 window: the profile depth, or 1 (median of 3) in front of the adaptive filter
+void filter_setup()
+{
+    LoadCell.setSamplesInUse(filter_mode == 1 ? 1 : filter_window());
+}
+
+//follow the averaged HX711 rate, the sample based timing is only derived again on a real change
+void rate_update()
+{
+    float sps = LoadCell.getMeasuredSPS();
+    if (sps <= 0.0f || fabs(sps - rate_sps) < RATE_CHANGE * rate_sps)
+    {
+        return;
+    }
+
+    rate_sps = sps;
+    rate_dt = 1.0f / sps;
+    dither_block = constrain(int(DITHER_BLOCK * RATE_REF_SPS / sps + 0.5f), DITHER_BLOCK, DITHER_BLOCK_MAX);
+    filter_setup();
+}
+
+//group delay of the load filter and the DAC ramp in s (dt = time of one conversion): centre of the averaging window
+float filter_delay(float dt)
+{
+    float ramp = (normal == 1) ? DAC_INTERP_FAC * dt / 2.0f : 0.0f; //mean delay of the DAC ramp
+
+    if (filter_mode == 1)
+    {
+        return dt * (1.0f + (afilter.window - 1) / 2.0f) + ramp; //median of 3 + adaptive window
     }
+    float hampel = HAMPEL_WINDOW ? dt : 0.0f; //first conversion of a step is held back one conversion
+    return dt * (LoadCell.getSamplesInUse() + 1) / 2.0f + hampel + ramp; //HX711 window of samples + 2
+}
+
+//compile a profile into the spare buffer, no task reads it => no lock, false = curve not monotone (gamma used)
+bool profile_prepare(const brake_profile_t &p, const brake_curve_t &c)
+{
+    int b = profile_spare;
+    return profile_compile(p, c, profile_rt[b], profile_curve_ram[b]) == 0;
+}
+
+//the prepared spare buffer becomes profile i, the old buffer is the next spare (under Acquire while the tasks run)
+void profile_swap(int i)
+{
+    int b = profile_spare;
+    profile_spare = profile_buf[i];
+    profile_buf[i] = b;
+    if (i == active_profile)
+    {
+        profile_active = &profile_rt[b];
+    }
+}
+
+//compile profile i into the spare buffer and swap it in
+void profile_build(int i, const brake_profile_t &p, const brake_curve_t &c)
+{
+    bool monotone = profile_prepare(p, c);
+    profile_swap(i);
+    if (!monotone)
+    {
+        print_serial_and_bt("Force curve not monotone, gamma used", 1);
+    }
+}
+
+//the RAM break variables did change (wizard) => compile them for the output
+void profile_refresh()
+{
+    brake_profile_t p = flash_cfg.profiles[active_profile];
+    profile_from_ram(p);
+    profile_build(active_profile, p, flash_cfg.curves[active_profile]);
+    filter_setup();
 }
 
 void pause_multitask()
@@ -140,6 +454,14 @@ void pause_multitask()
     //This is just during when we interact with the program with commands (serial commands)
     //until we are not finished the process with the commands the program stop the task
 
+    num_token_reset(serial_num); //no half typed number from before
+    num_token_reset(bt_num);
+
+    //acquisition task first, a running sample is finished before the wizard takes the load cell
+    acquire_paused = true;
+    xSemaphoreTake(Acquire, portMAX_DELAY);
+    xSemaphoreGive(Acquire);
+
     //give the normalization = 2 => pause
     xSemaphoreTake(Semaphore, portMAX_DELAY);
     normalization = 2; //turn of multi task part of voltage in pwm2dac function
@@ -159,12 +481,14 @@ void restart_multitask()
     //until we are not finished the process with the commands the program stop the task
 
     //tell multitask to take variables again an set normal back to original 0 or 1
+    profile_refresh(); //a wizard may have changed the break variables
     vTaskDelay(3000); //3 sec delay
     xSemaphoreTake(Semaphore, portMAX_DELAY);
     normalization = normal; //give back the normal 0 or 1 (0=raw input != output on G29, 1=adjusted so that 50% load in = 50% load out)
     open2use = true;
     xSemaphoreGive(Semaphore);
     vTaskDelay(200); //3 sec delay
+    acquire_paused = false;
 }
 
 void SDPrint()
@@ -175,6 +499,7 @@ void SDPrint()
     print_serial_and_bt("***", 1);
     print_serial_and_bt("SerailDataOutput?", 1);
     print_serial_and_bt("Send 'y' or 'n'", 1);
+    print_serial_and_bt("or 'c' for a trace: millis,load each sample", 1);
 
     boolean _resume = false;
     while (_resume == false)
@@ -195,6 +520,11 @@ void SDPrint()
                 SerialPrintData = 0;
                 _resume = true;
             }
+            else if (inByte == 'c' || BTByte == 'c')
+            {
+                SerialPrintData = 2; //raw trace, input for tools/creep_fit
+                _resume = true;
+            }
         }
     }
     Serial.flush();   //clean buffer
@@ -248,7 +578,7 @@ void simulation_esp32()
 
     print_serial_and_bt("***", 1);
     print_serial_and_bt("case was used: ", 0);
-    print_serial_and_bt(String(simulant_case), 1);
+    print_num_serial_and_bt((long)simulant_case, 1);
 }
 
 void reboot_mc()
@@ -256,6 +586,17 @@ void reboot_mc()
     reboot_esp32 = true;
 }
 
+//save only the tare, changed but not saved RAM variables stay out of flash
+void save_tare_flash(float tare_noise)
+{
+    flash_cfg.tare_offset = LoadCell.getTareOffset();
+    if (tare_noise >= 0.0f) //-1 = keep the stored fingerprint
+    {
+        flash_cfg.tare_noise = tare_noise;
+    }
+    config_store_save(flash_cfg);
+}
+
 void tara_load_cell()
 {
     print_serial_and_bt("***", 1);
@@ -263,46 +604,133 @@ void tara_load_cell()
 
     LoadCell.update();
     LoadCell.tareNoDelay();
+    auto_zero_reset(autozero);
+    creep_reset(creep);
+    adaptive_filter_reset(afilter);
+    predictor_reset(predictor);
 
     print_serial_and_bt("Tara finished", 1);
     print_serial_and_bt("***", 1);
 }
 
-void load_variables_eeprom(int ja_nein)
+//copy the RAM variables into the config struct
+void config_from_ram(brake_config_t &cfg)
 {
-
-    if (ja_nein == 1) //from EEPROM = 1, and from RAM = 0
+    cfg.calibration_value = newCalibrationValue;
+    cfg.max_break = max_break;
+    cfg.min_break = min_break;
+    cfg.max_break_redfac = max_break_redfac;
+    cfg.max_break_volt = max_break_volt;
+    cfg.min_break_volt = min_break_volt;
+    cfg.normal = normal;
+    cfg.gammafac = gammafac;
+    cfg.creep_amplitude = creep_amplitude;
+    cfg.creep_tau = creep_tau;
+    cfg.cal_offset = cal_offset;
+    cfg.cal_quad = cal_quad;
+    cfg.lin_points = lin_points;
+    memcpy(cfg.lin_span, lin_span, sizeof(lin_span));
+    memcpy(cfg.lin_game, lin_game, sizeof(lin_game));
+    cfg.filter_mode = filter_mode;
+    cfg.predict_on = predict_on;
+    cfg.active_profile = active_profile;
+    profile_from_ram(cfg.profiles[active_profile]);
+    if (!profile_used(cfg.profiles[active_profile]))
     {
-#if defined(ESP8266) || defined(ESP32)
-        EEPROM.begin(512); // uncomment this if you use ESP8266/ESP32 and want to fetch the calibration value from eeprom
-#endif
-        int temp_adress = 0;
-        EEPROM.get(calVal_eepromAdress, newCalibrationValue);
-        LoadCell.setCalFactor(newCalibrationValue); // set calibration value (float)
+        strncpy(cfg.profiles[active_profile].name, "default", PROFILE_NAME_LEN - 1);
+    }
+}
 
-        temp_adress += sizeof(newCalibrationValue);
-        EEPROM.get(temp_adress, max_break); //get  max break
+//compile the used profiles of cfg, no lock needed: the ones the output does not run on are swapped in at once,
+//the running one (active_profile) waits in the spare buffer for config_apply()
+//0 = nothing waiting, 1 = waiting, -1 = waiting with a force curve what is not monotone (gamma used)
+int config_prepare(const brake_config_t &cfg)
+{
+    int waiting = 0;
+    for (int i = 0; i < PROFILE_MAX; i++)
+    {
+        if (!profile_used(cfg.profiles[i]))
+        {
+            continue;
+        }
+        if (i != active_profile)
+        {
+            profile_build(i, cfg.profiles[i], cfg.curves[i]);
+            continue;
+        }
+        waiting = profile_prepare(cfg.profiles[i], cfg.curves[i]) ? 1 : -1;
+    }
+    return waiting;
+}
 
-        temp_adress += sizeof(max_break);
-        EEPROM.get(temp_adress, min_break); //get also mix break
+//the RAM variables and the profile waiting from config_prepare() (under Acquire while the tasks run)
+void config_apply(const brake_config_t &cfg, int waiting)
+{
+    newCalibrationValue = cfg.calibration_value;
+    normal = cfg.normal;
+    creep_amplitude = cfg.creep_amplitude;
+    creep_tau = cfg.creep_tau;
+    cal_offset = cfg.cal_offset;
+    cal_quad = cfg.cal_quad;
+    filter_mode = cfg.filter_mode;
+    predict_on = cfg.predict_on;
+
+    //all profiles are compiled now => switching later is just a pointer
+    if (waiting != 0)
+    {
+        profile_swap(active_profile);
+    }
+    active_profile = cfg.active_profile;
+    profile_active = &profile_rt[profile_buf[active_profile]];
+    profile_to_ram(cfg.profiles[active_profile]);
+    filter_setup();
+}
 
-        temp_adress += sizeof(min_break);
-        EEPROM.get(temp_adress, max_break_redfac); //get also max reduced break factor
+//copy the config struct back into the RAM variables
+void config_to_ram(const brake_config_t &cfg)
+{
+    int waiting = config_prepare(cfg);
+    config_apply(cfg, waiting);
+    if (waiting < 0)
+    {
+        print_serial_and_bt("Force curve not monotone, gamma used", 1);
+    }
+}
 
-        temp_adress += sizeof(max_break_redfac);
-        EEPROM.get(temp_adress, max_break_volt); //get also max voltage
+//save all variables, the flash write itself is done later by config_store_service() in the loop
+void save_variables_flash()
+{
+    config_from_ram(flash_cfg);
+    config_store_save(flash_cfg);
 
-        temp_adress += sizeof(max_break_volt);
-        EEPROM.get(temp_adress, min_break_volt); //get also min voltage
+    print_serial_and_bt("Saved to flash", 1);
+    print_serial_and_bt("", 1);
+}
 
-        temp_adress += sizeof(max_break_redfac);
-        EEPROM.get(temp_adress, normal); //Save also max break
+void load_variables_flash(int ja_nein)
+{
 
-        temp_adress += sizeof(normal);
-        EEPROM.get(temp_adress, gammafac); //get also max reduced break factor
+    if (ja_nein == 1) //from flash = 1, and from RAM = 0
+    {
+        //the RAM values are the fallback if nothing (valid) is stored
+        config_from_ram(flash_cfg);
+        int load_result = config_store_load(flash_cfg);
+        config_to_ram(flash_cfg);
+        LoadCell.setCalFactor(newCalibrationValue); // set calibration value (float)
 
         print_serial_and_bt("", 1);
-        print_serial_and_bt("*** EEPROM Read OUT ***", 0);
+        if (load_result == 1)
+        {
+            print_serial_and_bt("*** Flash Read OUT ***", 0);
+        }
+        else if (load_result == 0)
+        {
+            print_serial_and_bt("*** Flash empty, defaults used ***", 0);
+        }
+        else
+        {
+            print_serial_and_bt("*** Flash config corrupt, defaults used ***", 0);
+        }
     }
     else
     {
@@ -310,41 +738,98 @@ void load_variables_eeprom(int ja_nein)
         print_serial_and_bt("*** RAM Read OUT ***", 0);
     }
 
+    print_serial_and_bt("", 1);
+    print_serial_and_bt("profile : ", 0);
+    print_num_serial_and_bt((long)active_profile + 1, 0);
+    print_serial_and_bt(" ", 0);
+    print_serial_and_bt(flash_cfg.profiles[active_profile].name, 0);
+
     print_serial_and_bt("", 1);
     print_serial_and_bt("Max break Kg: ", 0);
-    print_serial_and_bt(String(max_break / kg_factor), 0);
+    print_num_serial_and_bt(max_break / kg_factor, 2, 0);
 
     print_serial_and_bt("", 1);
     print_serial_and_bt("Min break RedFac %: ", 0);
-    print_serial_and_bt(String(max_break_redfac), 0);
+    print_num_serial_and_bt(max_break_redfac, 2, 0);
 
     print_serial_and_bt("", 1);
     print_serial_and_bt("Min break Kg: ", 0);
-    print_serial_and_bt(String(min_break / kg_factor), 0);
+    print_num_serial_and_bt(min_break / kg_factor, 2, 0);
 
     print_serial_and_bt("", 1);
     print_serial_and_bt("calibration value : ", 0);
-    print_serial_and_bt(String(newCalibrationValue), 0);
+    print_num_serial_and_bt(newCalibrationValue, 2, 0);
+
+    print_serial_and_bt("", 1);
+    print_serial_and_bt("cal. offset / quad : ", 0);
+    print_num_serial_and_bt(cal_offset, 2, 0);
+    print_serial_and_bt(" / ", 0);
+    print_num_serial_and_bt(cal_quad, 10, 0);
 
     print_serial_and_bt("", 1);
     print_serial_and_bt("Max Break Voltage: ", 0);
-    print_serial_and_bt(String(max_break_volt), 0);
+    print_num_serial_and_bt((long)max_break_volt, 0);
     print_serial_and_bt("/", 0);
-    print_serial_and_bt(String(max_break_volt * ref_voltage), 0);
+    print_num_serial_and_bt(max_break_volt * ref_voltage, 2, 0);
 
     print_serial_and_bt("", 1);
     print_serial_and_bt("Min Break Voltage: ", 0);
-    print_serial_and_bt(String(min_break_volt), 0);
+    print_num_serial_and_bt((long)min_break_volt, 0);
     print_serial_and_bt("/", 0);
-    print_serial_and_bt(String(min_break_volt * ref_voltage), 0);
+    print_num_serial_and_bt(min_break_volt * ref_voltage, 2, 0);
 
     print_serial_and_bt("", 1);
     print_serial_and_bt("normalizion : ", 0);
-    print_serial_and_bt(String(normal), 0);
+    print_num_serial_and_bt((long)normal, 0);
 
     print_serial_and_bt("", 1);
     print_serial_and_bt("gamma factor : ", 0);
-    print_serial_and_bt(String(gammafac), 0);
+    print_num_serial_and_bt(gammafac, 2, 0);
+
+    print_serial_and_bt("", 1);
+    print_serial_and_bt("filter samples : ", 0);
+    print_num_serial_and_bt((long)filter_samples, 0);
+    print_serial_and_bt(filter_mode == 1 ? " adaptive" : " fixed", 0);
+    print_serial_and_bt(predict_on == 1 ? " + predictor" : "", 0);
+
+    print_serial_and_bt("", 1);
+    print_serial_and_bt("measured SPS : ", 0);
+    print_num_serial_and_bt(LoadCell.getMeasuredSPS(), 2, 0);
+    print_serial_and_bt(" (filter window ", 0);
+    print_num_serial_and_bt((long)filter_window(), 0);
+    print_serial_and_bt(", dither ", 0);
+    print_num_serial_and_bt((long)dither_block, 0);
+    print_serial_and_bt(")", 0);
+
+    print_serial_and_bt("", 1);
+    print_serial_and_bt("DAC ramp ms : ", 0);
+    print_num_serial_and_bt(DAC_INTERP_FAC * rate_dt * 1000.0f, 2, 0);
+    print_serial_and_bt(" (max. added latency, mean the half)", 0);
+
+    print_serial_and_bt("", 1);
+    print_serial_and_bt("rejected samples : ", 0);
+    print_num_serial_and_bt((long)LoadCell.getRejectedSamples(), 0); //spikes, since boot
+
+    print_serial_and_bt("", 1);
+    print_serial_and_bt("saturated samples : ", 0);
+    print_num_serial_and_bt((long)LoadCell.getSaturatedSamples(), 0); //ADC limit, since boot
+
+    print_serial_and_bt("", 1);
+    print_serial_and_bt("game lin. points : ", 0);
+    if (lin_points > 0)
+    {
+        print_num_serial_and_bt((long)lin_points, 0);
+    }
+    else
+    {
+        print_serial_and_bt("built in", 0);
+    }
+
+    print_serial_and_bt("", 1);
+    print_serial_and_bt("creep % / tau s : ", 0);
+    print_num_serial_and_bt(creep_amplitude * 100.0, 2, 0);
+    print_serial_and_bt(" / ", 0);
+    print_num_serial_and_bt(creep_tau, 2, 0);
 
     print_serial_and_bt("", 1);
     print_serial_and_bt("file name : ", 0);
@@ -352,6 +837,29 @@ void load_variables_eeprom(int ja_nein)
     print_serial_and_bt("", 1);
 }
 
+//next number typed on Serial or BT, false as long as none is complete (never waits on the stream)
+bool read_number(float &value)
+{
+    int ev;
+    while ((ev = num_token_poll(serial_num, Serial, NUM_TOKEN_IDLE_MS)) != NUM_TOKEN_NONE)
+    {
+        if (ev == NUM_TOKEN_VALUE)
+        {
+            value = serial_num.value;
+            return true;
+        }
+    }
+    while ((ev = num_token_poll(bt_num, SerialBT, NUM_TOKEN_IDLE_MS)) != NUM_TOKEN_NONE)
+    {
+        if (ev == NUM_TOKEN_VALUE)
+        {
+            value = bt_num.value;
+            return true;
+        }
+    }
+    return false;
+}
+
 int calicalulation_break(float &value2change, float value2compare, int flag2compare, int calc_type)
 {
 
@@ -401,12 +909,9 @@ int calicalulation_break(float &value2change, float value2compare, int flag2comp
         _resume = false;
         while (_resume == false)
         {
-            if (Serial.available() > 0 || SerialBT.available())
+            float temp_redfac;
+            if (read_number(temp_redfac))
             {
-
-                float temp_redfac = Serial.parseFloat();
-                float temp_redfacBT = SerialBT.parseFloat();
-
                 if (temp_redfac == -1)
                 {
                     _resume = true;
@@ -418,18 +923,6 @@ int calicalulation_break(float &value2change, float value2compare, int flag2comp
                     _resume = true;
                     return 0;
                 }
-
-                if (temp_redfacBT == -1)
-                {
-                    _resume = true;
-                    return -1;
-                }
-                else if (temp_redfacBT > 0.0f && temp_redfacBT <= 100.0f)
-                {
-                    value2change = temp_redfacBT;
-                    _resume = true;
-                    return 0;
-                }
             }
         }
     }
@@ -479,18 +972,18 @@ void calibrate()
 
     print_serial_and_bt("", 1);
     print_serial_and_bt("Max break Kg: ", 1);
-    print_serial_and_bt(String(max_break / kg_factor), 0);
+    print_num_serial_and_bt(max_break / kg_factor, 2, 0);
 
     print_serial_and_bt("", 1);
     print_serial_and_bt("Max break Reduce Factor: ", 0);
-    print_serial_and_bt(String(max_break_redfac), 0);
+    print_num_serial_and_bt(max_break_redfac, 2, 0);
 
     print_serial_and_bt("", 1);
     print_serial_and_bt("Min break Kg: ", 0);
-    print_serial_and_bt(String(min_break / kg_factor), 0);
+    print_num_serial_and_bt(min_break / kg_factor, 2, 0);
 
     print_serial_and_bt("", 1);
-    print_serial_and_bt("Save into EEPROM? y/n", 0);
+    print_serial_and_bt("Save into flash? y/n", 0);
     print_serial_and_bt("", 1);
 
     bool _resume = false;
@@ -503,27 +996,7 @@ void calibrate()
             char BTByte = SerialBT.read();
             if (inByte == 'y' || BTByte == 'y')
             {
-#if defined(ESP8266) || defined(ESP32)
-                EEPROM.begin(512);
-#endif
-                int temp_adress = 0;
-                EEPROM.put(calVal_eepromAdress, newCalibrationValue);
-
-                temp_adress += sizeof(newCalibrationValue);
-                EEPROM.put(temp_adress, max_break); //Save also max break
-
-                temp_adress += sizeof(max_break);
-                EEPROM.put(temp_adress, min_break); //Save also max break
-
-                temp_adress += sizeof(min_break);
-                EEPROM.put(temp_adress, max_break_redfac); //get also max reduced break factor
-
-#if defined(ESP8266) || defined(ESP32)
-                EEPROM.commit();
-#endif
-
-                print_serial_and_bt("Saved to EEPROM", 1);
-                print_serial_and_bt("", 1);
+                save_variables_flash();
 
                 _resume = true;
             }
@@ -550,7 +1023,7 @@ void change_breake_load_values()
 
     print_serial_and_bt("***", 1);
     print_serial_and_bt("NOW: MAX break Kg: ", 0);
-    print_serial_and_bt(String(max_break / kg_factor), 1);
+    print_num_serial_and_bt(max_break / kg_factor, 2, 1);
     print_serial_and_bt("NEW value in Kg (Example: 15.23)", 1);
     print_serial_and_bt("or -1 without changes", 1);
     print_serial_and_bt("***", 1);
@@ -565,7 +1038,7 @@ void change_breake_load_values()
 
     print_serial_and_bt("***", 1);
     print_serial_and_bt("NOW: MIN break Kg: ", 0);
-    print_serial_and_bt(String(min_break / kg_factor), 1);
+    print_num_serial_and_bt(min_break / kg_factor, 2, 1);
     print_serial_and_bt("NEW value in Kg: ", 1);
     print_serial_and_bt("Greater then Zero!!!", 1);
     print_serial_and_bt("or -1 without changes", 1);
@@ -595,18 +1068,18 @@ void change_breake_load_values()
 
         print_serial_and_bt("", 1);
         print_serial_and_bt("Max break Kg: ", 0);
-        print_serial_and_bt(String(max_break / kg_factor), 0);
+        print_num_serial_and_bt(max_break / kg_factor, 2, 0);
 
         print_serial_and_bt("", 1);
         print_serial_and_bt("Max break Reduce Factor: ", 0);
-        print_serial_and_bt(String(max_break_redfac), 0);
+        print_num_serial_and_bt(max_break_redfac, 2, 0);
 
         print_serial_and_bt("", 1);
         print_serial_and_bt("Min break Kg: ", 0);
-        print_serial_and_bt(String(min_break / kg_factor), 0);
+        print_num_serial_and_bt(min_break / kg_factor, 2, 0);
 
         print_serial_and_bt("", 1);
-        print_serial_and_bt("Save into EEPROM? y/n", 0);
+        print_serial_and_bt("Save into flash? y/n", 0);
         print_serial_and_bt("", 1);
 
         bool _resume = false;
@@ -619,27 +1092,7 @@ void change_breake_load_values()
                 char BTByte = SerialBT.read();
                 if (inByte == 'y' || BTByte == 'y')
                 {
-#if defined(ESP8266) || defined(ESP32)
-                    EEPROM.begin(512);
-#endif
-                    int temp_adress = 0;
-                    EEPROM.put(calVal_eepromAdress, newCalibrationValue);
-
-                    temp_adress += sizeof(newCalibrationValue);
-                    EEPROM.put(temp_adress, max_break); //Save also max break
-
-                    temp_adress += sizeof(max_break);
-                    EEPROM.put(temp_adress, min_break); //Save also max break
-
-                    temp_adress += sizeof(min_break);
-                    EEPROM.put(temp_adress, max_break_redfac); //get also max reduced break factor
-
-#if defined(ESP8266) || defined(ESP32)
-                    EEPROM.commit();
-#endif
-
-                    print_serial_and_bt("Saved to EEPROM", 1);
-                    print_serial_and_bt("", 1);
+                    save_variables_flash();
                     _resume = true;
                 }
                 else if (inByte == 'n' || BTByte == 'n')
@@ -664,74 +1117,42 @@ void change_breake_load_values()
 
 void calicalc_volt(int &value2change, int error_voltage)
 {
-    int temp_volt_min;
-    int temp_volt_minBT;
+    int temp_volt_min = value2change;
 
     boolean _resume = false;
     while (_resume == false)
     {
-        if (Serial.available() > 0)
+        float typed;
+        if (read_number(typed))
         {
-            String inByte = Serial.readStringUntil('\n');
-            int temp_volt = inByte.toInt();
+            int temp_volt = int(typed);
 
-            if (inByte.toInt() == -2)
+            if (temp_volt == -2)
             {
                 value2change = temp_volt_min;
                 _resume = true;
             }
-            else if (inByte.toInt() == -1)
+            else if (temp_volt == -1)
             {
                 _resume = true;
             }
-            else if (inByte.toInt() >= 0 && inByte.toInt() <= 255)
+            else if (temp_volt >= 0 && temp_volt <= 255)
             {
                 temp_volt_min = temp_volt;
 
                 dacWrite(DAC1, temp_volt); //sending voltage to break and look at TV/Monitor to find min Break
 
                 print_serial_and_bt("Temp Volt bit/Volt: ", 1);
-                print_serial_and_bt(String(temp_volt), 0);
+                print_num_serial_and_bt((long)temp_volt, 0);
                 print_serial_and_bt("/", 0);
-                print_serial_and_bt(String(temp_volt * ref_voltage), 0);
+                print_num_serial_and_bt(temp_volt * ref_voltage, 2, 0);
                 print_serial_and_bt("", 1);
             }
-            else if (inByte.toInt() < 0 || inByte.toInt() > 255)
+            else if (temp_volt < 0 || temp_volt > 255)
             {
                 temp_volt = error_voltage;
             }
         }
-        else if (SerialBT.available())
-        {
-            String temp = SerialBT.readString();
-            int temp_voltBT = temp.toInt();
-
-            if (temp_voltBT == -2)
-            {
-                value2change = temp_volt_minBT;
-                _resume = true;
-            }
-            else if (temp_voltBT == -1)
-            {
-                _resume = true;
-            }
-            else if (temp_voltBT >= 0 && temp_voltBT <= 255)
-            {
-                temp_volt_minBT = temp_voltBT;
-
-                dacWrite(DAC1, temp_voltBT); //sending voltage to break and look at TV/Monitor to find min Break
-
-                print_serial_and_bt("Temp VoltBT bit/Volt: ", 1);
-                print_serial_and_bt(String(temp_voltBT), 0);
-                print_serial_and_bt("/", 0);
-                print_serial_and_bt(String(temp_voltBT * ref_voltage), 0);
-                print_serial_and_bt("", 1);
-            }
-            else if (temp_voltBT < 0 || temp_voltBT > 255)
-            {
-                temp_voltBT = error_voltage;
-            }
-        }
     }
 }
 
@@ -742,9 +1163,9 @@ void voltage_cali()
 
     print_serial_and_bt("***", 1);
     print_serial_and_bt("Current MAX Break Volt bit/Volt: ", 1);
-    print_serial_and_bt(String(max_break_volt), 0);
+    print_num_serial_and_bt((long)max_break_volt, 0);
     print_serial_and_bt("/", 0);
-    print_serial_and_bt(String(max_break_volt * ref_voltage), 1);
+    print_num_serial_and_bt(max_break_volt * ref_voltage, 2, 1);
     print_serial_and_bt("Start cali MAX Break volt for 100% breaking:", 1);
     print_serial_and_bt("Adjust the volt to max breaking (100%)", 1);
     print_serial_and_bt("Values range 0 to 255", 1);
@@ -760,9 +1181,9 @@ void voltage_cali()
 
     print_serial_and_bt("***", 1);
     print_serial_and_bt("Current MIN Break Volt bit/Volt: ", 1);
-    print_serial_and_bt(String(min_break_volt), 0);
+    print_num_serial_and_bt((long)min_break_volt, 0);
     print_serial_and_bt("/", 0);
-    print_serial_and_bt(String(min_break_volt * ref_voltage), 1);
+    print_num_serial_and_bt(min_break_volt * ref_voltage, 2, 1);
     print_serial_and_bt("Start cali MIN Break volt for 0% breaking:", 1);
     print_serial_and_bt("Adjust the volt to MIN breaking (0%)", 1);
     print_serial_and_bt("Values range 0 to 255", 1);
@@ -779,20 +1200,20 @@ void voltage_cali()
 
     print_serial_and_bt("", 1);
     print_serial_and_bt("Max Break Voltage: ", 0);
-    print_serial_and_bt(String(max_break_volt), 0);
+    print_num_serial_and_bt((long)max_break_volt, 0);
     print_serial_and_bt("/", 0);
-    print_serial_and_bt(String(max_break_volt * ref_voltage), 0);
+    print_num_serial_and_bt(max_break_volt * ref_voltage, 2, 0);
     print_serial_and_bt("", 1);
 
     print_serial_and_bt("", 1);
     print_serial_and_bt("Min Break Voltage: ", 0);
-    print_serial_and_bt(String(min_break_volt), 0);
+    print_num_serial_and_bt((long)min_break_volt, 0);
     print_serial_and_bt("/", 0);
-    print_serial_and_bt(String(min_break_volt * ref_voltage), 0);
+    print_num_serial_and_bt(min_break_volt * ref_voltage, 2, 0);
     print_serial_and_bt("", 1);
 
     print_serial_and_bt("", 1);
-    print_serial_and_bt("Save Data EEPROM: 'y' or not 'n'", 0);
+    print_serial_and_bt("Save Data flash: 'y' or not 'n'", 0);
     print_serial_and_bt("", 1);
 
     boolean _resume = false;
@@ -804,25 +1225,7 @@ void voltage_cali()
             char BTByte = SerialBT.read();
             if (inByte == 'y' || BTByte == 'y')
             {
-#if defined(ESP8266) || defined(ESP32)
-                EEPROM.begin(512);
-#endif
-                int temp_adress = 0;
-                temp_adress += sizeof(newCalibrationValue);
-                temp_adress += sizeof(max_break);
-                temp_adress += sizeof(min_break);
-
-                temp_adress += sizeof(max_break_redfac);
-                EEPROM.put(temp_adress, max_break_volt); //get also max voltage
-                temp_adress += sizeof(max_break_volt);
-                EEPROM.put(temp_adress, min_break_volt); //get also min voltage
-
-#if defined(ESP8266) || defined(ESP32)
-                EEPROM.commit();
-#endif
-
-                print_serial_and_bt("Saved to EEPROM", 1);
-                print_serial_and_bt("", 1);
+                save_variables_flash();
 
                 _resume = true;
             }
@@ -837,37 +1240,204 @@ void voltage_cali()
     print_serial_and_bt("***", 1);
 }
 
-void weight_reference_calibration_first_time()
+//numbers of a text already in RAM (a command line), fed through a num_token byte by byte,
+//separated by anything what is not a number; returns how many (at most max_values)
+int parse_value_list(const char *p, float *values, int max_values)
+{
+    num_token_t nt;
+    num_token_reset(nt);
+    int n = 0;
+    for (; n < max_values; p++)
+    {
+        if (num_token_feed(nt, *p != 0 ? *p : '\n') == NUM_TOKEN_VALUE)
+        {
+            values[n++] = nt.value;
+        }
+        if (*p == 0)
+        {
+            break;
+        }
+    }
+    return n;
+}
+
+//the numbers of one line from Serial or BT, the wizard waits here but nothing blocks on the stream
+int read_value_list(float *values, int max_values)
+{
+    int n = 0;
+    for (;;)
+    {
+        int ev = num_token_poll(serial_num, Serial, NUM_TOKEN_IDLE_MS);
+        num_token_t *nt = &serial_num;
+        if (ev == NUM_TOKEN_NONE)
+        {
+            ev = num_token_poll(bt_num, SerialBT, NUM_TOKEN_IDLE_MS);
+            nt = &bt_num;
+        }
+
+        if (ev == NUM_TOKEN_VALUE && n < max_values)
+        {
+            values[n++] = nt->value;
+        }
+        else if (ev == NUM_TOKEN_EOL)
+        {
+            return n;
+        }
+        else if (ev == NUM_TOKEN_NONE)
+        {
+            vTaskDelay(1);
+        }
+    }
+}
+
+void game_linearization_capture()
 {
-    float newCalibrationValue = 0.00f;
     Serial.flush();   //clean buffer
     SerialBT.flush(); //clean buffer
 
     print_serial_and_bt("***", 1);
-    print_serial_and_bt("Start cali: reference weight:", 1);
-    print_serial_and_bt("This should just be done one time ", 1);
-    print_serial_and_bt("or first time. Is a ref. point ", 1);
-    print_serial_and_bt("to messure in Kg later:", 1);
-    print_serial_and_bt("Remove any load applied to the LC.", 1);
-    print_serial_and_bt("Send 't' for tare offset.", 1);
+    print_serial_and_bt("Game linearization capture:", 1);
+    print_serial_and_bt("The DAC steps from 0% to 100% break volt.", 1);
+    print_serial_and_bt("Note the break % in the game at each step.", 1);
+    print_serial_and_bt("Number of steps (3 - 32)?", 1);
+
+    float steps_in[1];
+    int steps = 0;
+    while (steps < 3 || steps > LIN_MAX_POINTS)
+    {
+        if (read_value_list(steps_in, 1) == 1)
+            steps = int(steps_in[0] + 0.5);
+    }
 
-    boolean _resume = false;
-    while (_resume == false)
+    int step_bit[LIN_MAX_POINTS];
+    for (int i = 0; i < steps; i++)
     {
-        LoadCell.update();
-        if (Serial.available() > 0 || SerialBT.available())
+        step_bit[i] = int(mapping(i, 0, steps - 1, min_break_volt, max_break_volt) + 0.5);
+        dacWrite(DAC1, step_bit[i]); //sending voltage to break and look at TV/Monitor
+
+        print_serial_and_bt("Step ", 0);
+        print_num_serial_and_bt((long)i + 1, 0);
+        print_serial_and_bt("/", 0);
+        print_num_serial_and_bt((long)steps, 0);
+        print_serial_and_bt(" bit: ", 0);
+        print_num_serial_and_bt((long)step_bit[i], 0);
+        print_serial_and_bt("  'n' for next", 1);
+
+        boolean _resume = false;
+        while (_resume == false)
         {
             if (Serial.available() > 0 || SerialBT.available())
             {
                 char inByte = Serial.read();
                 char BTByte = SerialBT.read();
-                if (inByte == 't' || BTByte == 't')
-                    LoadCell.tareNoDelay();
+                if (inByte == 'n' || BTByte == 'n')
+                    _resume = true;
             }
         }
-        if (LoadCell.getTareStatus() == true)
-        {
-            print_serial_and_bt("Tare complete", 1);
+    }
+    dacWrite(DAC1, min_break_volt); //back to 0% break
+
+    Serial.flush();   //clean buffer
+    SerialBT.flush(); //clean buffer
+    print_serial_and_bt("Send all game break % in one line", 1);
+    print_serial_and_bt("comma separated, example: 0,4.5,11,...", 1);
+
+    float game_percent[LIN_MAX_POINTS];
+    int got = read_value_list(game_percent, LIN_MAX_POINTS);
+    if (got != steps)
+    {
+        print_serial_and_bt("Wrong number of values, nothing changed", 1);
+        print_serial_and_bt("***", 1);
+        return;
+    }
+
+    float span[LIN_MAX_POINTS];
+    float game[LIN_MAX_POINTS];
+    for (int i = 0; i < steps; i++)
+    {
+        span[i] = (min_break_volt == max_break_volt) ? 0.0f : mapping(step_bit[i], min_break_volt, max_break_volt, 0.0, 1.0);
+        game[i] = game_percent[i] / 100.0f;
+        bitcheckfloat(game[i], 0.0f, 1.0f);
+    }
+
+    float test_lut[LIN_LUT_SIZE];
+    if (lin_build(span, game, steps, test_lut, LIN_LUT_SIZE) != 0)
+    {
+        print_serial_and_bt("Values do not rise, nothing changed", 1);
+        print_serial_and_bt("***", 1);
+        return;
+    }
+
+    lin_points = steps;
+    memcpy(lin_span, span, sizeof(float) * steps);
+    memcpy(lin_game, game, sizeof(float) * steps);
+
+    print_serial_and_bt("game % / DAC bit", 1);
+    for (int p = 0; p <= 100; p += 10)
+    {
+        print_num_serial_and_bt((long)p, 0);
+        print_serial_and_bt(" / ", 0);
+        print_num_serial_and_bt(mapping(lin_lookup(test_lut, LIN_LUT_SIZE, p / 100.0), 0.0, 1.0, min_break_volt, max_break_volt), 2, 1);
+    }
+
+    print_serial_and_bt("", 1);
+    print_serial_and_bt("Save into flash? y/n", 0);
+    print_serial_and_bt("", 1);
+
+    boolean _resume = false;
+    while (_resume == false)
+    {
+        if (Serial.available() > 0 || SerialBT.available())
+        {
+            char inByte = Serial.read();
+            char BTByte = SerialBT.read();
+            if (inByte == 'y' || BTByte == 'y')
+            {
+                save_variables_flash();
+                _resume = true;
+            }
+            else if (inByte == 'n' || BTByte == 'n')
+            {
+                _resume = true;
+            }
+        }
+    }
+
+    print_serial_and_bt("End game linearization", 1);
+    print_serial_and_bt("***", 1);
+}
+
+void weight_reference_calibration_first_time()
+{
+    Serial.flush();   //clean buffer
+    SerialBT.flush(); //clean buffer
+
+    print_serial_and_bt("***", 1);
+    print_serial_and_bt("Start cali: reference weight:", 1);
+    print_serial_and_bt("This should just be done one time ", 1);
+    print_serial_and_bt("or first time. Is a ref. point ", 1);
+    print_serial_and_bt("to messure in Kg later:", 1);
+    print_serial_and_bt("Remove any load applied to the LC.", 1);
+    print_serial_and_bt("Send 't' for tare offset.", 1);
+
+    boolean _resume = false;
+    while (_resume == false)
+    {
+        LoadCell.update();
+        if (Serial.available() > 0 || SerialBT.available())
+        {
+            if (Serial.available() > 0 || SerialBT.available())
+            {
+                char inByte = Serial.read();
+                char BTByte = SerialBT.read();
+                if (inByte == 't' || BTByte == 't')
+                    LoadCell.tareNoDelay();
+            }
+        }
+        if (LoadCell.getTareStatus() == true)
+        {
+            print_serial_and_bt("Tare complete", 1);
+            save_tare_flash(-1.0f); //the wizard took the status, tare_done is not set => keep the new zero here
             _resume = true;
         }
     }
@@ -880,37 +1450,22 @@ void weight_reference_calibration_first_time()
     print_serial_and_bt("or -1 without changes", 1);
 
     float known_mass = 0;
-    float known_massBT = 0;
     _resume = false;
     while (_resume == false)
     {
         LoadCell.update();
-        if (Serial.available() > 0 || SerialBT.available())
+        if (read_number(known_mass))
         {
-            known_mass = Serial.parseFloat();
-            known_massBT = SerialBT.parseFloat();
             if (known_mass > 0)
             {
                 print_serial_and_bt("Known mass is: ", 0);
-                print_serial_and_bt(String(known_mass), 1);
+                print_num_serial_and_bt(known_mass, 2, 1);
                 _resume = true;
             }
             else if (known_mass == -1)
             {
                 _resume = true;
             }
-
-            if (known_massBT > 0)
-            {
-                print_serial_and_bt("Known mass is: ", 0);
-                print_serial_and_bt(String(known_massBT), 1);
-                known_mass = known_massBT;
-                _resume = true;
-            }
-            else if (known_massBT == -1)
-            {
-                _resume = true;
-            }
         }
     }
 
@@ -922,12 +1477,12 @@ void weight_reference_calibration_first_time()
 
         //get the new calibration value
         newCalibrationValue = LoadCell.getNewCalibration(known_mass);
+        cal_offset = 0.0f; //single point = linear through zero
+        cal_quad = 0.0f;
 
         print_serial_and_bt("New calibration value: ", 0);
-        print_serial_and_bt(String(newCalibrationValue), 0);
-        print_serial_and_bt("Save value to EEPROM: ", 0);
-        print_serial_and_bt(String(calVal_eepromAdress), 0);
-        print_serial_and_bt("? y/n", 1);
+        print_num_serial_and_bt(newCalibrationValue, 2, 0);
+        print_serial_and_bt("Save value to flash? y/n", 1);
 
         _resume = false;
         while (_resume == false)
@@ -940,7 +1495,7 @@ void weight_reference_calibration_first_time()
                 {
                     print_serial_and_bt("", 0);
                     print_serial_and_bt("You are realy sure", 1);
-                    print_serial_and_bt("Save to EEPROM? y/n", 0);
+                    print_serial_and_bt("Save to flash? y/n", 0);
                     print_serial_and_bt("", 0);
 
                     while (_resume == false)
@@ -952,19 +1507,7 @@ void weight_reference_calibration_first_time()
                             char BTByte = SerialBT.read();
                             if (inByte == 'y' || BTByte == 'y')
                             {
-#if defined(ESP8266) || defined(ESP32)
-                                EEPROM.begin(512);
-#endif
-                                EEPROM.put(calVal_eepromAdress, newCalibrationValue);
-
-#if defined(ESP8266) || defined(ESP32)
-                                EEPROM.commit();
-#endif
-                                EEPROM.get(calVal_eepromAdress, newCalibrationValue);
-                                print_serial_and_bt("Value ", 0);
-                                print_serial_and_bt(String(newCalibrationValue), 0);
-                                print_serial_and_bt(" saved to EEPROM address: ", 0);
-                                print_serial_and_bt(String(calVal_eepromAdress), 1);
+                                save_variables_flash();
                                 _resume = true;
                             }
                         }
@@ -972,7 +1515,7 @@ void weight_reference_calibration_first_time()
                 }
                 else if (inByte == 'n' || BTByte == 'n')
                 {
-                    print_serial_and_bt("Value not saved to EEPROM", 1);
+                    print_serial_and_bt("Value not saved to flash", 1);
                     _resume = true;
                 }
             }
@@ -990,6 +1533,205 @@ void weight_reference_calibration_first_time()
     delay(3000);
 }
 
+//average over n new conversions after the whole dataset was refreshed (= settled)
+float settled_average(int n)
+{
+    LoadCell.refreshDataSet();
+
+    float sum = 0.0f;
+    int got = 0;
+    while (got < n)
+    {
+        if (LoadCell.update())
+        {
+            sum += LoadCell.getData();
+            got++;
+        }
+        yield();
+    }
+    return sum / n;
+}
+
+void multi_point_calibration()
+{
+    float raw_point[CAL_MAX_POINTS];  //HX711 data to the tare with calFactor 1
+    float mass_point[CAL_MAX_POINTS]; //reference load in gram
+    int points = 0;
+    float old_calfac = LoadCell.getCalFactor();
+
+    Serial.flush();   //clean buffer
+    SerialBT.flush(); //clean buffer
+
+    print_serial_and_bt("***", 1);
+    print_serial_and_bt("Start multi point calibration:", 1);
+    print_serial_and_bt("Remove any load applied to the LC.", 1);
+    print_serial_and_bt("Send 't' for tare offset.", 1);
+
+    boolean _resume = false;
+    while (_resume == false)
+    {
+        LoadCell.update();
+        if (Serial.available() > 0 || SerialBT.available())
+        {
+            char inByte = Serial.read();
+            char BTByte = SerialBT.read();
+            if (inByte == 't' || BTByte == 't')
+                LoadCell.tareNoDelay();
+        }
+        if (LoadCell.getTareStatus() == true)
+        {
+            print_serial_and_bt("Tare complete", 1);
+            save_tare_flash(-1.0f); //the wizard took the status, tare_done is not set => keep the new zero here
+            _resume = true;
+        }
+    }
+
+    //zero point, then the fit works in raw counts
+    LoadCell.setCalFactor(1.0);
+    raw_point[0] = settled_average(CAL_AVG_SAMPLES);
+    mass_point[0] = 0.0f;
+    points = 1;
+
+    while (points < CAL_MAX_POINTS)
+    {
+        Serial.flush();   //clean buffer
+        SerialBT.flush(); //clean buffer
+
+        print_serial_and_bt("Point ", 0);
+        print_num_serial_and_bt((long)points, 1);
+        print_serial_and_bt("Place ref load on the LC.", 1);
+        print_serial_and_bt("Give the ref load into GRAM", 1);
+        print_serial_and_bt("'-2' to finish, '-1' to abort", 1);
+
+        float known_mass = 0.0f;
+        _resume = false;
+        while (_resume == false)
+        {
+            LoadCell.update();
+            float temp_mass;
+            if (read_number(temp_mass))
+            {
+                if (temp_mass > 0.0f || temp_mass == -1.0f || temp_mass == -2.0f)
+                {
+                    known_mass = temp_mass;
+                    _resume = true;
+                }
+            }
+        }
+
+        if (known_mass == -1.0f)
+        {
+            LoadCell.setCalFactor(old_calfac);
+            print_serial_and_bt("Multi point calibration aborted", 1);
+            print_serial_and_bt("***", 1);
+            return;
+        }
+        if (known_mass == -2.0f)
+            break;
+
+        raw_point[points] = settled_average(CAL_AVG_SAMPLES);
+        mass_point[points] = known_mass;
+        points++;
+
+        print_serial_and_bt("Raw: ", 0);
+        print_num_serial_and_bt(raw_point[points - 1], 2, 0);
+        print_serial_and_bt("  for gram: ", 0);
+        print_num_serial_and_bt(known_mass, 2, 1);
+    }
+
+    int order = 1;
+    if (points >= 3)
+    {
+        Serial.flush();   //clean buffer
+        SerialBT.flush(); //clean buffer
+        print_serial_and_bt("Quadratic term? y/n", 1);
+
+        _resume = false;
+        while (_resume == false)
+        {
+            if (Serial.available() > 0 || SerialBT.available())
+            {
+                char inByte = Serial.read();
+                char BTByte = SerialBT.read();
+                if (inByte == 'y' || BTByte == 'y')
+                {
+                    order = 2;
+                    _resume = true;
+                }
+                else if (inByte == 'n' || BTByte == 'n')
+                {
+                    _resume = true;
+                }
+            }
+        }
+    }
+
+    float coef[3];
+    if (calibration_fit(raw_point, mass_point, points, order, coef) != 0 || coef[1] == 0.0f)
+    {
+        LoadCell.setCalFactor(old_calfac);
+        print_serial_and_bt("Not enough or wrong points, try again!!!", 1);
+        print_serial_and_bt("***", 1);
+        return;
+    }
+
+    print_serial_and_bt("", 1);
+    print_serial_and_bt("gram / fitted / residual", 1);
+    for (int i = 0; i < points; i++)
+    {
+        float fitted = calibration_eval(coef, order, raw_point[i]);
+        print_num_serial_and_bt(mass_point[i], 2, 0);
+        print_serial_and_bt(" / ", 0);
+        print_num_serial_and_bt(fitted, 2, 0);
+        print_serial_and_bt(" / ", 0);
+        print_num_serial_and_bt(mass_point[i] - fitted, 2, 1);
+    }
+
+    //gain goes into the HX711 calFactor, offset and quadratic term are applied after getData()
+    newCalibrationValue = 1.0f / coef[1];
+    LoadCell.setCalFactor(newCalibrationValue);
+    cal_offset = coef[0];
+    cal_quad = coef[2] / (coef[1] * coef[1]);
+    auto_zero_reset(autozero);
+    creep_reset(creep);
+    adaptive_filter_reset(afilter);
+    predictor_reset(predictor);
+
+    print_serial_and_bt("calibration value : ", 0);
+    print_num_serial_and_bt(newCalibrationValue, 2, 1);
+    print_serial_and_bt("offset : ", 0);
+    print_num_serial_and_bt(cal_offset, 2, 1);
+    print_serial_and_bt("quadratic : ", 0);
+    print_num_serial_and_bt(cal_quad, 10, 1);
+
+    print_serial_and_bt("", 1);
+    print_serial_and_bt("Save into flash? y/n", 0);
+    print_serial_and_bt("", 1);
+
+    _resume = false;
+    while (_resume == false)
+    {
+        LoadCell.update();
+        if (Serial.available() > 0 || SerialBT.available())
+        {
+            char inByte = Serial.read();
+            char BTByte = SerialBT.read();
+            if (inByte == 'y' || BTByte == 'y')
+            {
+                save_variables_flash();
+                _resume = true;
+            }
+            else if (inByte == 'n' || BTByte == 'n')
+            {
+                _resume = true;
+            }
+        }
+    }
+
+    print_serial_and_bt("End multi point calibration", 1);
+    print_serial_and_bt("***", 1);
+}
+
 void normalisation()
 {
 
@@ -1040,14 +1782,9 @@ void normalisation()
         _resume = false;
         while (_resume == false)
         {
-            if (Serial.available() > 0 || SerialBT.available())
+            float temp_gamma;
+            if (read_number(temp_gamma))
             {
-                float temp_gamma = 0.0f;
-                temp_gamma = Serial.parseFloat();
-
-                float temp_gammaBT = 0.0f;
-                temp_gammaBT = SerialBT.parseFloat();
-
                 if (temp_gamma == -1)
                 {
                     _resume = true;
@@ -1057,15 +1794,6 @@ void normalisation()
                     gammafac = temp_gamma;
                     _resume = true;
                 }
-                if (temp_gammaBT == -1)
-                {
-                    _resume = true;
-                }
-                else if (temp_gammaBT <= 4.0f && temp_gammaBT >= 0.25f)
-                {
-                    gammafac = temp_gammaBT;
-                    _resume = true;
-                }
             }
         }
     }
@@ -1073,7 +1801,7 @@ void normalisation()
     SerialBT.flush(); //clean buffer
 
     print_serial_and_bt("", 1);
-    print_serial_and_bt("Save into EEPROM? y/n", 0);
+    print_serial_and_bt("Save into flash? y/n", 0);
     print_serial_and_bt("", 1);
 
     _resume = false;
@@ -1086,28 +1814,7 @@ void normalisation()
             BTByte = SerialBT.read();
             if (inByte == 'y' || BTByte == 'y')
             {
-#if defined(ESP8266) || defined(ESP32)
-                EEPROM.begin(512);
-#endif
-                int temp_adress = 0;
-                temp_adress += sizeof(newCalibrationValue);
-                temp_adress += sizeof(max_break);
-                temp_adress += sizeof(min_break);
-                temp_adress += sizeof(max_break_redfac);
-                temp_adress += sizeof(max_break_volt);
-                temp_adress += sizeof(max_break_redfac);
-
-                EEPROM.put(temp_adress, normal); //Save also max break
-
-                temp_adress += sizeof(normal);
-                EEPROM.put(temp_adress, gammafac); //get also max reduced break factor
-
-#if defined(ESP8266) || defined(ESP32)
-                EEPROM.commit();
-#endif
-
-                print_serial_and_bt("Saved to EEPROM", 1);
-                print_serial_and_bt("", 1);
+                save_variables_flash();
                 _resume = true;
             }
             else if (inByte == 'n' || BTByte == 'n')
@@ -1121,61 +1828,509 @@ void normalisation()
     print_serial_and_bt("***", 1);
 }
 
-void SerialPrintOutCollector(long c, int lc_out, float mapped_voltage, bool nmal, float gfac, float wiper, int outputtype)
+void creep_cali()
 {
-    if (outputtype == 1)
-    {
-        print_serial_and_bt(String(c), 0);
-        print_serial_and_bt(" LC output Kg: ", 0);
-        print_serial_and_bt(String(lc_out / kg_factor), 0);
-        /*
-        print_serial_and_bt(" dev2tara%: ", 0);
-        print_serial_and_bt(String((lc_out * 100.0) / max_break), 0);
-        */
-
-        print_serial_and_bt("  DAC1: ", 0);
-        print_serial_and_bt(String(round(mapped_voltage)), 0);
-        print_serial_and_bt("/", 0);
-        print_serial_and_bt(String((mapped_voltage / 255.0) * 3.30), 0);
-        print_serial_and_bt("V", 1);
+    Serial.flush();   //clean buffer
+    SerialBT.flush(); //clean buffer
 
-        /*
-        print_serial_and_bt("  MaxB: ", 0);
-        print_serial_and_bt(String(max_break / kg_factor), 0);
+    print_serial_and_bt("***", 1);
+    print_serial_and_bt("Creep compensation?", 1);
+    print_serial_and_bt("Send 'y' or 'n'", 1);
 
-        print_serial_and_bt("  Max Break RedFac: ", 0);
-        print_serial_and_bt(String(max_break_redfac), 0);
+    char inByte;
+    char BTByte;
 
-        print_serial_and_bt("  MinB: ", 0);
-        print_serial_and_bt(String(min_break / kg_factor), 0);
-        print_serial_and_bt("", 1);
-        */
-    }
-    else if (outputtype == 2)
+    boolean _resume = false;
+    while (_resume == false)
     {
-        print_serial_and_bt(String(c), 0);
-        print_serial_and_bt(" LC Kg: ", 0);
-        print_serial_and_bt(String(lc_out / kg_factor), 0);
-
-        /*
-        print_serial_and_bt(" Gamma: ", 0);
-        print_serial_and_bt(String(gfac), 0);
-        */
-
-        print_serial_and_bt(" DAC1: ", 0);
-        print_serial_and_bt(String(mapped_voltage), 0);
-        print_serial_and_bt("/", 0);
-        print_serial_and_bt(String((mapped_voltage / 255.0) * 3.30), 0);
-        print_serial_and_bt("V", 0);
-
-        print_serial_and_bt(" Weight in %: ", 0);
-        print_serial_and_bt(String(wiper * 100.0), 1);
+        LoadCell.update();
+        if (Serial.available() > 0 || SerialBT.available())
+        {
+            inByte = Serial.read();
+            BTByte = SerialBT.read();
+            if (inByte == 'y' || BTByte == 'y')
+            {
+                _resume = true;
+            }
+            else if (inByte == 'n' || BTByte == 'n')
+            {
+                creep_amplitude = 0.0f;
+                _resume = true;
+            }
+        }
+    }
+
+    if ((inByte == 'y' || BTByte == 'y'))
+    {
+        Serial.flush();   //clean buffer
+        SerialBT.flush(); //clean buffer
+
+        print_serial_and_bt("***", 1);
+        print_serial_and_bt("Creep amplitude in % (Example: 2.5)", 1);
+        print_serial_and_bt("fitted with tools/creep_fit", 1);
+        print_serial_and_bt("With '-1' no changes", 1);
+        print_serial_and_bt("***", 1);
+
+        float temp_amplitude = creep_amplitude * 100.0f;
+        if (calicalulation_break(temp_amplitude, 0, 0, 2) != -1)
+        {
+            creep_amplitude = temp_amplitude / 100.0f;
+            bitcheckfloat(creep_amplitude, 0.0f, 0.5f); //more then 50% is no creep anymore
+        }
+        Serial.flush();   //clean buffer
+        SerialBT.flush(); //clean buffer
+
+        print_serial_and_bt("***", 1);
+        print_serial_and_bt("Creep time constant in s (Example: 4.0)", 1);
+        print_serial_and_bt("With '-1' no changes", 1);
+        print_serial_and_bt("***", 1);
+
+        calicalulation_break(creep_tau, 0, 0, 2);
+    }
+    creep_reset(creep);
+
+    Serial.flush();   //clean buffer
+    SerialBT.flush(); //clean buffer
+
+    print_serial_and_bt("", 1);
+    print_serial_and_bt("Creep %: ", 0);
+    print_num_serial_and_bt(creep_amplitude * 100.0, 2, 0);
+    print_serial_and_bt("  tau s: ", 0);
+    print_num_serial_and_bt(creep_tau, 2, 1);
+
+    print_serial_and_bt("", 1);
+    print_serial_and_bt("Save into flash? y/n", 0);
+    print_serial_and_bt("", 1);
+
+    _resume = false;
+    while (_resume == false)
+    {
+        LoadCell.update();
+        if (Serial.available() > 0 || SerialBT.available())
+        {
+            inByte = Serial.read();
+            BTByte = SerialBT.read();
+            if (inByte == 'y' || BTByte == 'y')
+            {
+                save_variables_flash();
+                _resume = true;
+            }
+            else if (inByte == 'n' || BTByte == 'n')
+            {
+                _resume = true;
+            }
+        }
+    }
+
+    print_serial_and_bt("End creep", 1);
+    print_serial_and_bt("***", 1);
+}
+
+void filter_cali()
+{
+    Serial.flush();   //clean buffer
+    SerialBT.flush(); //clean buffer
+
+    print_serial_and_bt("***", 1);
+    print_serial_and_bt("Adaptive filter?", 1);
+    print_serial_and_bt("raw data on a fast break, average while holding", 1);
+    print_serial_and_bt("Send 'y' or 'n'", 1);
+
+    char inByte;
+    char BTByte;
+
+    boolean _resume = false;
+    while (_resume == false)
+    {
+        LoadCell.update();
+        if (Serial.available() > 0 || SerialBT.available())
+        {
+            inByte = Serial.read();
+            BTByte = SerialBT.read();
+            if (inByte == 'y' || BTByte == 'y')
+            {
+                filter_mode = 1;
+                _resume = true;
+            }
+            else if (inByte == 'n' || BTByte == 'n')
+            {
+                filter_mode = 0;
+                _resume = true;
+            }
+        }
+    }
+    adaptive_filter_reset(afilter);
+    filter_setup();
+
+    Serial.flush();   //clean buffer
+    SerialBT.flush(); //clean buffer
+
+    print_serial_and_bt("***", 1);
+    print_serial_and_bt("Predictor?", 1);
+    print_serial_and_bt("less delay of the filter, more noise", 1);
+    print_serial_and_bt("Send 'y' or 'n'", 1);
+
+    _resume = false;
+    while (_resume == false)
+    {
+        LoadCell.update();
+        if (Serial.available() > 0 || SerialBT.available())
+        {
+            inByte = Serial.read();
+            BTByte = SerialBT.read();
+            if (inByte == 'y' || BTByte == 'y')
+            {
+                predict_on = 1;
+                _resume = true;
+            }
+            else if (inByte == 'n' || BTByte == 'n')
+            {
+                predict_on = 0;
+                _resume = true;
+            }
+        }
+    }
+    predictor_reset(predictor);
+
+    Serial.flush();   //clean buffer
+    SerialBT.flush(); //clean buffer
+
+    print_serial_and_bt("", 1);
+    print_serial_and_bt(filter_mode == 1 ? "Adaptive filter, max samples: " : "Moving average, samples: ", 0);
+    print_num_serial_and_bt((long)filter_samples, 0);
+    print_serial_and_bt(predict_on == 1 ? " + predictor" : "", 1);
+
+    print_serial_and_bt("", 1);
+    print_serial_and_bt("Save into flash? y/n", 0);
+    print_serial_and_bt("", 1);
+
+    _resume = false;
+    while (_resume == false)
+    {
+        LoadCell.update();
+        if (Serial.available() > 0 || SerialBT.available())
+        {
+            inByte = Serial.read();
+            BTByte = SerialBT.read();
+            if (inByte == 'y' || BTByte == 'y')
+            {
+                save_variables_flash();
+                _resume = true;
+            }
+            else if (inByte == 'n' || BTByte == 'n')
+            {
+                _resume = true;
+            }
+        }
+    }
+
+    print_serial_and_bt("End filter", 1);
+    print_serial_and_bt("***", 1);
+}
+
+//switch to profile i (shown as i + 1), no pause: all profiles are compiled, the next sample uses the new one
+//changes of the old profile what are not saved are dropped
+bool profile_switch(int i)
+{
+    if (i < 0 || i >= PROFILE_MAX || !profile_used(flash_cfg.profiles[i]))
+    {
+        print_serial_and_bt("Profile not used", 1);
+        return false;
+    }
+
+    int old = active_profile;
+    xSemaphoreTake(Acquire, portMAX_DELAY); //not during a sample, the filter window may change
+    profile_active = &profile_rt[profile_buf[i]];
+    active_profile = i;
+    profile_to_ram(flash_cfg.profiles[i]);
+    filter_setup();
+    xSemaphoreGive(Acquire);
+
+    //a batch without "save" was compiled into the old profile => back to the stored one, the output does not use it now
+    if (old != i && profile_used(flash_cfg.profiles[old]))
+    {
+        profile_build(old, flash_cfg.profiles[old], flash_cfg.curves[old]);
+    }
+
+    flash_cfg.active_profile = i; //active profile survives a reboot, the RAM variables what are not saved do not
+    config_store_save(flash_cfg);
+
+    print_serial_and_bt("Profile ", 0);
+    print_num_serial_and_bt((long)(i + 1), 0);
+    print_serial_and_bt(": ", 0);
+    print_serial_and_bt(flash_cfg.profiles[i].name, 1);
+    return true;
+}
+
+void profile_list()
+{
+    for (int i = 0; i < PROFILE_MAX; i++)
+    {
+        const brake_profile_t &p = flash_cfg.profiles[i];
+        print_num_serial_and_bt((long)i + 1, 0);
+        print_serial_and_bt(i == active_profile ? " * " : "   ", 0);
+        if (!profile_used(p))
+        {
+            print_serial_and_bt("-", 1);
+            continue;
+        }
+        print_serial_and_bt(p.name, 0);
+        print_serial_and_bt("  volt ", 0);
+        print_num_serial_and_bt((long)p.min_break_volt, 0);
+        print_serial_and_bt("/", 0);
+        print_num_serial_and_bt((long)p.max_break_volt, 0);
+        print_serial_and_bt("  Kg ", 0);
+        print_num_serial_and_bt(p.min_break / kg_factor, 2, 0);
+        print_serial_and_bt("/", 0);
+        print_num_serial_and_bt(p.max_break / kg_factor, 2, 0);
+        print_serial_and_bt("  gamma ", 0);
+        print_num_serial_and_bt(p.gammafac, 2, 0);
+        print_serial_and_bt("  filter ", 0);
+        print_num_serial_and_bt((long)p.filter_samples, 1);
+    }
+}
+
+//store the current break variables as a profile
+void profile_menu()
+{
+    Serial.flush();   //clean buffer
+    SerialBT.flush(); //clean buffer
+
+    print_serial_and_bt("***", 1);
+    print_serial_and_bt("Profiles (* = active)", 1);
+    profile_list();
+    print_serial_and_bt("Switch any time with 'p1' - 'p4'", 1);
+    print_serial_and_bt("", 1);
+    print_serial_and_bt("Store the current settings as profile number (1 - 4)", 1);
+    print_serial_and_bt("With '-1' no changes", 1);
+    print_serial_and_bt("***", 1);
+
+    float temp_profile = active_profile + 1;
+    if (calicalulation_break(temp_profile, 0, 0, 2) == -1 || temp_profile < 1 || temp_profile > PROFILE_MAX)
+    {
+        print_serial_and_bt("End profiles", 1);
+        print_serial_and_bt("***", 1);
+        return;
+    }
+    int n = int(temp_profile) - 1;
+
+    Serial.flush();   //clean buffer
+    SerialBT.flush(); //clean buffer
+
+    print_serial_and_bt("***", 1);
+    print_serial_and_bt("Name of the profile (Example: ACC), max ", 0);
+    print_num_serial_and_bt((long)PROFILE_NAME_LEN - 1, 0);
+    print_serial_and_bt(" characters", 1);
+    print_serial_and_bt("***", 1);
+
+    char name[CMD_LINE_MAX] = "";
+    char *trimmed = name;
+    while (trimmed[0] == 0)
+    {
+        LoadCell.update();
+        int len = 0;
+        if (Serial.available() > 0)
+        {
+            len = Serial.readBytesUntil('\n', name, CMD_LINE_MAX - 1);
+        }
+        else if (SerialBT.available())
+        {
+            len = SerialBT.readBytesUntil('\n', name, CMD_LINE_MAX - 1);
+        }
+        while (len > 0 && isSpace(name[len - 1])) //'\r' of the terminal and spaces
+        {
+            len--;
+        }
+        name[len] = 0;
+        trimmed = name;
+        while (isSpace(*trimmed))
+        {
+            trimmed++;
+        }
+    }
+
+    Serial.flush();   //clean buffer
+    SerialBT.flush(); //clean buffer
+
+    print_serial_and_bt("***", 1);
+    print_serial_and_bt("HX711 filter samples 1 - ", 0);
+    print_num_serial_and_bt((long)SAMPLES, 0);
+    print_serial_and_bt(" (less = faster, more = smoother)", 1);
+    print_serial_and_bt("at 89 SPS, other rates get the same time", 1);
+    print_serial_and_bt("With '-1' no changes", 1);
+    print_serial_and_bt("***", 1);
+
+    float temp_filter = filter_samples;
+    if (calicalulation_break(temp_filter, 0, 0, 2) != -1)
+    {
+        filter_samples = constrain(int(temp_filter), 1, SAMPLES);
+    }
+
+    //the RAM variables are now profile n, restart_multitask() compiles it
+    active_profile = n;
+    memset(flash_cfg.profiles[n].name, 0, PROFILE_NAME_LEN);
+    strncpy(flash_cfg.profiles[n].name, trimmed, PROFILE_NAME_LEN - 1);
+    save_variables_flash();
+
+    profile_list();
+    print_serial_and_bt("End profiles", 1);
+    print_serial_and_bt("***", 1);
+}
+
+void force_curve_print()
+{
+    const brake_curve_t &c = flash_cfg.curves[active_profile];
+    if (c.points == 0)
+    {
+        print_serial_and_bt("Force curve: gamma ", 0);
+        print_num_serial_and_bt(gammafac, 2, 1);
+        return;
+    }
+
+    print_serial_and_bt("Force curve load % / break %", 1);
+    for (int i = 0; i < c.points; i++)
+    {
+        print_num_serial_and_bt(c.load[i] * 100.0, 2, 0);
+        print_serial_and_bt(" / ", 0);
+        print_num_serial_and_bt(c.brake[i] * 100.0, 2, 1);
+    }
+}
+
+//force curve of the active profile in one line, compiled and swapped in without stopping the output
+//  f 0,0,30,10,70,60,100,100   load %,break % pairs (2 - 16 pairs)
+//  fb 40,0,60,100              bezier control points x1,y1,x2,y2 in %
+//  f off                       back to the gamma
+//  f                           print the curve
+//false if the input is wrong
+bool force_curve_command(const char *line)
+{
+    //trimmed copy, no String: this command runs without a pause
+    char cmd[CMD_LINE_MAX];
+    while (*line == ' ')
+    {
+        line++;
+    }
+    strncpy(cmd, line, CMD_LINE_MAX - 1);
+    cmd[CMD_LINE_MAX - 1] = 0;
+    for (int n = strlen(cmd); n > 0 && isSpace(cmd[n - 1]); n--)
+    {
+        cmd[n - 1] = 0;
+    }
+
+    brake_curve_t c;
+    memset(&c, 0, sizeof(c));
+    float v[2 * CURVE_MAX_POINTS + 1];
+
+    if (strncmp(cmd, "fb", 2) == 0)
+    {
+        int n = parse_value_list(cmd + 2, v, 5);
+        if (n != 4 || curve_from_bezier(c, v[0] / 100.0f, v[1] / 100.0f, v[2] / 100.0f, v[3] / 100.0f) != 0)
+        {
+            print_serial_and_bt("Bezier: x1,y1,x2,y2 in %, the curve must not fall", 1);
+            return false;
+        }
+    }
+    else if (strcmp(cmd, "f off") == 0)
+    {
+        c.points = 0;
+    }
+    else
+    {
+        int n = parse_value_list(cmd + 1, v, 2 * CURVE_MAX_POINTS + 1);
+        if (n == 0)
+        {
+            force_curve_print();
+            return true;
+        }
+        if (n % 2 != 0 || n < 4 || n > 2 * CURVE_MAX_POINTS)
+        {
+            print_serial_and_bt("Send 2 - 16 pairs load %,break %", 1);
+            return false;
+        }
+        c.points = n / 2;
+        for (int i = 0; i < c.points; i++)
+        {
+            c.load[i] = v[2 * i] / 100.0f;
+            c.brake[i] = v[2 * i + 1] / 100.0f;
+        }
+        if (!curve_sane(c))
+        {
+            print_serial_and_bt("Load must rise, break must not fall, 0 - 100 %", 1);
+            return false;
+        }
+    }
+
+    flash_cfg.curves[active_profile] = c;
+    brake_profile_t p = flash_cfg.profiles[active_profile];
+    profile_from_ram(p);
+    bool monotone = profile_prepare(p, c); //512 points, outside the lock
+    xSemaphoreTake(Acquire, portMAX_DELAY);
+    profile_swap(active_profile); //the next sample uses it
+    xSemaphoreGive(Acquire);
+    if (!monotone)
+    {
+        print_serial_and_bt("Force curve not monotone, gamma used", 1);
+    }
+    save_variables_flash();
+    force_curve_print();
+    return true;
+}
+
+void SerialPrintOutCollector(long c, int lc_out, float mapped_voltage, bool nmal, float gfac, float wiper, int outputtype)
+{
+    if (outputtype == 1)
+    {
+        print_num_serial_and_bt(c, 0);
+        print_serial_and_bt(" LC output Kg: ", 0);
+        print_num_serial_and_bt(lc_out / kg_factor, 2, 0);
+        /*
+        print_serial_and_bt(" dev2tara%: ", 0);
+        print_num_serial_and_bt((lc_out * 100.0) / max_break, 2, 0);
+        */
+
+        print_serial_and_bt("  DAC1: ", 0);
+        print_num_serial_and_bt(lround(mapped_voltage), 0);
+        print_serial_and_bt("/", 0);
+        print_num_serial_and_bt((mapped_voltage / 255.0) * 3.30, 2, 0);
+        print_serial_and_bt("V", 1);
+
+        /*
+        print_serial_and_bt("  MaxB: ", 0);
+        print_num_serial_and_bt(max_break / kg_factor, 2, 0);
+
+        print_serial_and_bt("  Max Break RedFac: ", 0);
+        print_num_serial_and_bt(max_break_redfac, 2, 0);
+
+        print_serial_and_bt("  MinB: ", 0);
+        print_num_serial_and_bt(min_break / kg_factor, 2, 0);
+        print_serial_and_bt("", 1);
+        */
+    }
+    else if (outputtype == 2)
+    {
+        print_num_serial_and_bt(c, 0);
+        print_serial_and_bt(" LC Kg: ", 0);
+        print_num_serial_and_bt(lc_out / kg_factor, 2, 0);
+
+        /*
+        print_serial_and_bt(" Gamma: ", 0);
+        print_num_serial_and_bt(gfac, 2, 0);
+        */
+
+        print_serial_and_bt(" DAC1: ", 0);
+        print_num_serial_and_bt(mapped_voltage, 2, 0);
+        print_serial_and_bt("/", 0);
+        print_num_serial_and_bt((mapped_voltage / 255.0) * 3.30, 2, 0);
+        print_serial_and_bt("V", 0);
+
+        print_serial_and_bt(" Weight in %: ", 0);
+        print_num_serial_and_bt(wiper * 100.0, 2, 1);
         /*
         print_serial_and_bt(" MaxB: ", 0);
-        print_serial_and_bt(String(max_break / kg_factor), 0);
+        print_num_serial_and_bt(max_break / kg_factor, 2, 0);
 
         print_serial_and_bt(" MinB: ", 0);
-        print_serial_and_bt(String(min_break / kg_factor), 0);
+        print_num_serial_and_bt(min_break / kg_factor, 2, 0);
         print_serial_and_bt("", 1);
         */
     }
@@ -1205,652 +2360,1110 @@ void simulate_loadcell_sinus_curve(float &value2change)
         rad = 0.0; // zero degree
 }
 
-//Task (running simu with the loop, multi task)
-void pwm2dac(void *parameter)
+//Task (running simu with the loop, multi task)
+void pwm2dac(void *parameter)
+{
+    uint32_t seq_now = 0;
+    uint32_t seq_prev = 0;
+    int normaliz = 1;
+    float GLED = 0.0;
+    float target = 0.0;
+    unsigned long span = 0;
+    int block = DITHER_BLOCK;
+    float sigma = 0.0; //part of an upper bit not given yet, carried into the next block
+    dac_interp_t interp;
+    dac_interp_reset(interp, profile_active->min_break_volt); //a first ramp starts at 0% break, not at DAC bit 0
+    unsigned long loop_us = 0;
+
+    for (;;)
+    {
+        bool p2u = false;
+
+        unsigned long now_us = micros();
+        if (loop_us != 0 && normaliz != 2)
+        {
+            jitter_hist_add(output_hist, now_us - loop_us); //a long one = the task was preempted
+        }
+        loop_us = now_us;
+
+        xSemaphoreTake(Semaphore, portMAX_DELAY);
+        p2u = open2use;
+        xSemaphoreGive(Semaphore);
+
+        if (p2u)
+        {
+            if (normaliz == 0)
+            {
+                xSemaphoreTake(Semaphore, portMAX_DELAY);
+                GLED = GLED_global;
+                seq_now = published_seq;
+                normaliz = normalization;
+                xSemaphoreGive(Semaphore);
+            }
+            else if (normaliz == 1)
+            {
+                xSemaphoreTake(Semaphore, portMAX_DELAY);
+                target = dac_target_global;
+                span = (unsigned long)(DAC_INTERP_FAC * rate_dt * 1000000.0f); //ramp over one conversion
+                block = dither_block;
+                seq_now = published_seq;
+                normaliz = normalization;
+                xSemaphoreGive(Semaphore);
+            }
+
+            else if (normaliz == 2)
+            {
+                xSemaphoreTake(Semaphore, portMAX_DELAY);
+                normaliz = normalization;
+                xSemaphoreGive(Semaphore);
+            }
+        }
+
+        //loss accounting, counted here and printed by the telemetry task (no print in this loop)
+        uint32_t gap = seq_now - seq_prev; //unsigned, right over the wrap of 32 bit
+        if (gap != 0)
+        {
+            handoff.consumed++;
+            handoff.overwritten += gap - 1;
+        }
+        else if (p2u && normaliz != 2)
+        {
+            handoff.stale++;
+        }
+
+        //new sample => ramp from the output now to its target, no step at 89Herz
+        if (gap != 0 && normaliz == 1)
+        {
+            dac_interp_target(interp, target, micros(), span);
+        }
+
+        seq_prev = seq_now;
+
+        if (seq_now == 0)
+        {
+            continue; //no sample yet (boot, tare): the DAC keeps the 0% break voltage from setup()
+        }
+
+        if (normaliz == 0)
+        {
+
+            dacWrite(DAC1, round(GLED));
+        }
+        else if (normaliz == 1)
+        {
+            //one dither block at the ramp value: the fraction is the share of the upper bit,
+            //spread over the block (first order sigma delta) and not as 2 groups of writes
+            float v = dac_interp_value(interp, micros());
+            int lbc = int(floor(v));
+            int ubc = lbc + 1;
+            float frac = v - lbc;
+
+            //security check that we have right range 0 -255
+            bitcheckint(lbc, minbit, maxbit);
+            bitcheckint(ubc, minbit, maxbit);
+
+            for (int x = 0; x < block; x++)
+            {
+                sigma += frac;
+                if (sigma >= 1.0f)
+                {
+                    sigma -= 1.0f;
+                    dacWrite(DAC1, ubc);
+                }
+                else
+                {
+                    dacWrite(DAC1, lbc);
+                }
+            }
+        }
+    }
+}
+
+float calulate_dac_raw(float loadcellcleaned)
+{
+    const profile_runtime_t &pr = *profile_active;
+    float reduces_break;
+    float GLED;
+
+    //if max break to much, reduce not input side but output side adjust the voltage
+    if (pr.volt_direction_normal == true)
+    {
+        reduces_break = (float)pr.max_break_volt * (pr.max_break_redfac / 100.0); // example max_break_volt*0.80
+    }
+    else
+    {
+        reduces_break = (float)pr.max_break_volt * ((100.0 + (100.0 - pr.max_break_redfac)) / 100.0); // example max_break_volt*1.20
+    }
+
+    if (loadcellcleaned > pr.min_break && loadcellcleaned < pr.max_break)
+    {
+        GLED = mapping(loadcellcleaned, pr.min_break, pr.max_break, pr.min_break_volt, reduces_break); //LED need approx 160 as min value to shine
+
+        //give the needed voltage to given load=break force
+        //dacWrite(DAC1, round(GLED));
+    }
+    else
+    {
+        if (pr.volt_direction_normal == true)
+        {
+            if (loadcellcleaned <= pr.min_break)
+            {
+                GLED = (float)pr.min_break_volt - 3.0;
+                //bitcheckfloat(GLED, (float)minbit, (float)maxbit);
+            }
+            else if (loadcellcleaned >= pr.max_break)
+            {
+                GLED = (float)reduces_break + 3.0;
+                //bitcheckfloat(GLED, (float)minbit, (float)maxbit);
+            }
+        }
+        else
+        {
+            if (loadcellcleaned <= pr.min_break)
+            {
+                GLED = (float)pr.min_break_volt + 3.0;
+                //bitcheckfloat(GLED, (float)minbit, (float)maxbit);
+            }
+            else if (loadcellcleaned >= pr.max_break)
+            {
+                GLED = (float)reduces_break - 3.0;
+                //bitcheckfloat(GLED, (float)minbit, (float)maxbit);
+            }
+        }
+
+        //dacWrite(DAC1, round(GLED));
+    }
+
+    int GLEDTEMP = int(GLED + 0.5);
+    bitcheckint(GLEDTEMP, minbit, maxbit);
+    return (float)GLEDTEMP;
+}
+
+void calculate_dac_normalizated(float loadcellcleaned,
+                                float &weight_in_percent,
+                                int &lower_bit_case,
+                                float &dac_target)
+{
+
+    const profile_runtime_t &pr = *profile_active; //one profile for the whole sample, even if it is switched now
+
+    ////////////////// new from 29.12.2020 for the linearization
+    weight_in_percent = mapping(loadcellcleaned, pr.min_break, pr.max_break, 0.0, (pr.max_break_redfac / 100.0)); //mapping into %
+
+    //min or max break: give 3 bit more/less at the min/max ends
+    if (weight_in_percent < pr.lower_delta || weight_in_percent > pr.upper_delta)
+    {
+        int end_bit;
+        if (weight_in_percent < pr.lower_delta)
+        {
+            end_bit = (pr.volt_direction_normal == true) ? pr.min_break_volt - 3 : pr.min_break_volt + 3;
+        }
+        else
+        {
+            end_bit = (pr.volt_direction_normal == true) ? pr.max_break_volt + 3 : pr.max_break_volt - 3;
+        }
+        //security check that we have right range
+        bitcheckint(end_bit, minbit, maxbit);
+        lower_bit_case = end_bit;
+        dac_target = end_bit;
+        return;
+    }
+
+    //gamma and linearization of load to output => 50% load gives 50% break in PS4, O(1) table lookup
+    //gamma>2.0 means break at 50% is now  71% (faster break curve)
+    //gamma<0.5 means break at 50% is now just 25%  (slower break curve)
+    float span = lin_lookup(pr.curve, LIN_CURVE_SIZE, weight_in_percent);
+    float dac_bit = mapping(span, 0.0, 1.0, pr.min_break_volt, pr.max_break_volt);
+
+    //a bit between 2 DAC values is given as share of the lower and upper bit in pwm2dac (dither_block writes)
+    lower_bit_case = int(floor(dac_bit));
+
+    //security check that we have right range 0 -255
+    bitcheckint(lower_bit_case, minbit, maxbit);
+    bitcheckfloat(dac_bit, (float)minbit, (float)maxbit);
+    dac_target = dac_bit;
+}
+
+//'q' command and the telemetry: does the output task take every sample
+void handoff_report()
+{
+    handoff_stats_t hs = handoff; //copy first, the counters keep running
+    print_serial_and_bt("handoff produced ", 0);
+    print_num_serial_and_bt((long)hs.produced, 0);
+    print_serial_and_bt(" consumed ", 0);
+    print_num_serial_and_bt((long)hs.consumed, 0);
+    print_serial_and_bt(" overwritten ", 0);
+    print_num_serial_and_bt((long)hs.overwritten, 0);
+    print_serial_and_bt(" stale ", 0);
+    print_num_serial_and_bt((long)hs.stale, 0);
+    print_serial_and_bt(" pending ", 0);
+    print_num_serial_and_bt((long)(hs.produced - hs.consumed - hs.overwritten), 1); //0 or 1, more = output task stuck
+}
+
+//'o' command: the text sinks, also in the 'u' report
+void out_report()
+{
+    out_sink_t *sinks[2] = {&serial_sink, &bt_sink};
+    for (int i = 0; i < 2; i++)
+    {
+        out_sink_t &sk = *sinks[i];
+        print_serial_and_bt(sk.name, 0);
+        print_serial_and_bt(sk.attached ? ": attached" : ": detached", 0);
+        print_serial_and_bt(" buffered ", 0);
+        print_num_serial_and_bt((long)out_sink_used(sk), 0);
+        print_serial_and_bt(" max ", 0);
+        print_num_serial_and_bt((long)sk.high_water, 0);
+        print_serial_and_bt("/", 0);
+        print_num_serial_and_bt((long)sk.size, 0);
+        print_serial_and_bt(" sent ", 0);
+        print_num_serial_and_bt((long)sk.bytes, 0);
+        print_serial_and_bt(" dropped ", 0);
+        print_num_serial_and_bt((long)sk.dropped, 0);
+        print_serial_and_bt(" (", 0);
+        print_num_serial_and_bt((long)sk.dropped_bytes, 0);
+        print_serial_and_bt(" bytes)", 1);
+    }
+}
+
+//"os" / "ob": text output to Serial / BT off and on again, the command replies still come
+void out_toggle(out_sink_t &sk)
+{
+    if (sk.attached)
+    {
+        print_serial_and_bt(sk.name, 0);
+        print_serial_and_bt(" detached", 1);
+        out.detach(sk);
+    }
+    else
+    {
+        out.attach(sk);
+        print_serial_and_bt(sk.name, 0);
+        print_serial_and_bt(" attached", 1);
+    }
+}
+
+//'u' command: our tasks from the map, then the CPU share of all FreeRTOS tasks since boot
+void task_report()
+{
+    print_serial_and_bt("***", 1);
+    for (int i = 0; i < TASK_COUNT; i++)
+    {
+        const task_map_t &tm = task_map[i];
+        if (*tm.handle == NULL)
+        {
+            continue; //not started (drain tasks with OUT_NULL)
+        }
+        print_serial_and_bt(tm.name, 0);
+        print_serial_and_bt(": core ", 0);
+        print_num_serial_and_bt((long)tm.core, 0);
+        print_serial_and_bt(" prio ", 0);
+        print_num_serial_and_bt((long)tm.priority, 0);
+        print_serial_and_bt(" stack ", 0);
+        print_num_serial_and_bt((long)tm.stack, 0);
+        print_serial_and_bt(" free min ", 0);
+        print_num_serial_and_bt((long)uxTaskGetStackHighWaterMark(*tm.handle), 0);
+        print_serial_and_bt(" wakes ", 0);
+        if (i == TASK_OUTPUT)
+        {
+            print_serial_and_bt("- (never blocks)", 1);
+        }
+        else
+        {
+            print_num_serial_and_bt((long)task_wakes[i], 1);
+        }
+    }
+
+    out_report();
+
+    print_serial_and_bt("heap calls after setup: ", 0);
+    if (STATIC_ALLOC)
+    {
+        print_num_serial_and_bt((long)heap_guard_hits(), 0);
+        print_serial_and_bt(" ", 0);
+        print_serial_and_bt(heap_guard_last(), 1);
+    }
+    else
+    {
+        print_serial_and_bt("not counted (STATIC_ALLOC 0)", 1);
+    }
+
+#if configUSE_TRACE_FACILITY && configGENERATE_RUN_TIME_STATS
+    static TaskStatus_t status[TASK_STATUS_MAX]; //too big for the command task stack
+    uint32_t total = 0;
+    UBaseType_t n = uxTaskGetSystemState(status, TASK_STATUS_MAX, &total);
+    if (n == 0 || total == 0)
+    {
+        print_serial_and_bt("More tasks than TASK_STATUS_MAX", 1);
+        return;
+    }
+
+    print_serial_and_bt("CPU share since boot (% of one core, both cores = 200%):", 1);
+    for (UBaseType_t i = 0; i < n; i++)
+    {
+        print_serial_and_bt(status[i].pcTaskName, 0);
+        print_serial_and_bt(": ", 0);
+        print_num_serial_and_bt(100.0 * status[i].ulRunTimeCounter / total, 1, 0);
+        print_serial_and_bt("% prio ", 0);
+        print_num_serial_and_bt((long)status[i].uxCurrentPriority, 0);
+        print_serial_and_bt(" free min ", 0);
+        print_num_serial_and_bt((long)status[i].usStackHighWaterMark, 1);
+    }
+#else
+    print_serial_and_bt("CPU share: FreeRTOS run time stats are not in this build", 1);
+#endif
+    print_serial_and_bt("***", 1);
+}
+
+//'b' command: BT on/off, the free heap shows the RAM of the Bluedroid stack
+void bt_toggle()
+{
+    heap_guard_allow(true);
+    if (SerialBT.running())
+    {
+        print_serial_and_bt("Bluetooth off", 1);
+        SerialBT.stop();
+    }
+    else if (SerialBT.start())
+    {
+        print_serial_and_bt("Bluetooth on, pair with ESP32_G29_BreakSys", 1);
+    }
+    else
+    {
+        print_serial_and_bt("Bluetooth did not start (Bluedroid)", 1);
+    }
+    heap_guard_allow(false);
+    print_serial_and_bt("free heap: ", 0);
+    print_num_serial_and_bt((long)ESP.getFreeHeap(), 1);
+}
+
+//boot button held for BT_BUTTON_HOLD_MS => BT on (no serial cable at the rig)
+void bt_button_service()
+{
+    static unsigned long pressed_ms = 0;
+    if (digitalRead(BT_BUTTON) == HIGH)
+    {
+        pressed_ms = 0;
+        return;
+    }
+    if (pressed_ms == 0)
+    {
+        pressed_ms = millis();
+    }
+    else if (millis() - pressed_ms > BT_BUTTON_HOLD_MS && !SerialBT.running())
+    {
+        pressed_ms = millis(); //failed => the next try after one more hold time
+        if (SerialBT.start())
+        {
+            print_serial_and_bt("Bluetooth on (boot button)", 1);
+        }
+        else
+        {
+            print_serial_and_bt("Bluetooth did not start (Bluedroid)", 1);
+        }
+    }
+}
+
+void jitter_print(const char *title, const jitter_hist_t &jh)
+{
+    print_serial_and_bt(title, 1);
+    for (int i = 0; i < JH_BUCKETS; i++)
+    {
+        if (jh.count[i] == 0)
+        {
+            continue;
+        }
+        unsigned long limit = jitter_hist_limit(i);
+        print_serial_and_bt(limit != 0 ? "  < " : "  >= ", 0);
+        print_num_serial_and_bt((long)(limit != 0 ? limit : jitter_hist_limit(i - 1)), 0);
+        print_serial_and_bt(" us: ", 0);
+        print_num_serial_and_bt((long)jh.count[i], 1);
+    }
+    print_serial_and_bt("  max us: ", 0);
+    print_num_serial_and_bt((long)jh.max, 0);
+    print_serial_and_bt("  n: ", 0);
+    print_num_serial_and_bt((long)jh.n, 1);
+}
+
+//'j' command: the histograms since the last 'j', compare them with BT on and off ('b')
+void jitter_report()
+{
+    print_serial_and_bt("***", 1);
+    print_serial_and_bt(SerialBT.running() ? "Bluetooth on" : "Bluetooth off", 1);
+    jitter_print("DOUT interrupt => acquisition task:", wake_hist);
+    jitter_print("pwm2dac loop period:", output_hist);
+    jitter_hist_reset(wake_hist);
+    jitter_hist_reset(output_hist);
+    print_serial_and_bt("***", 1);
+}
+
+//break parameters what can be set with key=value, all in one batch (limits as in config_sane(), else the flash load fails)
+struct cmd_param_t
+{
+    const char *key;
+    float *f; //one of f and i
+    int *i;
+    float min;
+    float max;
+    int prof; //offset of the field in brake_profile_t, -1 = not in the profile
+};
+
+const cmd_param_t cmd_params[] = {
+    {"max_break", &max_break, NULL, 0.0f, 1.0e7f, offsetof(brake_profile_t, max_break)},
+    {"min_break", &min_break, NULL, 0.0f, 1.0e7f, offsetof(brake_profile_t, min_break)},
+    {"max_break_redfac", &max_break_redfac, NULL, 0.1f, 100.0f, offsetof(brake_profile_t, max_break_redfac)},
+    {"max_break_volt", NULL, &max_break_volt, 0.0f, 255.0f, offsetof(brake_profile_t, max_break_volt)},
+    {"min_break_volt", NULL, &min_break_volt, 0.0f, 255.0f, offsetof(brake_profile_t, min_break_volt)},
+    {"gammafac", &gammafac, NULL, 0.25f, 4.0f, offsetof(brake_profile_t, gammafac)},
+    {"normal", NULL, &normal, 0.0f, 1.0f, -1},
+    {"filter_samples", NULL, &filter_samples, 1.0f, (float)SAMPLES, offsetof(brake_profile_t, filter_samples)},
+    {"filter_mode", NULL, &filter_mode, 0.0f, 1.0f, -1},
+    {"predict_on", NULL, &predict_on, 0.0f, 1.0f, -1},
+    {"creep_amplitude", &creep_amplitude, NULL, 0.0f, 0.5f, -1},
+    {"creep_tau", &creep_tau, NULL, 0.1f, 100.0f, -1},
+};
+#define CMD_PARAMS (int)(sizeof(cmd_params) / sizeof(cmd_params[0]))
+
+int cmd_param_find(const char *key)
+{
+    for (int i = 0; i < CMD_PARAMS; i++)
+    {
+        if (strcmp(cmd_params[i].key, key) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+//a reply to the source only, written directly: the text buffered for it goes first, its drain task waits meanwhile
+void reply_begin(cmd_source_t &src)
+{
+    out_sink_t &sk = src.io == &Serial ? serial_sink : bt_sink;
+    out_sink_flush(sk, OUT_REPLY_FLUSH_MS);
+    out_sink_io_take(sk);
+    heap_guard_allow(true); //BT buffers
+}
+
+void reply_end(cmd_source_t &src)
+{
+    heap_guard_allow(false);
+    out_sink_io_give(src.io == &Serial ? serial_sink : bt_sink);
+}
+
+//machine readable reply to the source only: "OK ..." or "ERR <reason> <key>"
+void cmd_reply(cmd_source_t &src, const char *status, const char *reason, const char *key)
+{
+    reply_begin(src);
+    src.io->print(status);
+    if (reason != NULL)
+    {
+        src.io->print(" ");
+        src.io->print(reason);
+    }
+    if (key != NULL)
+    {
+        src.io->print(" ");
+        src.io->print(key);
+    }
+    src.io->print("\n");
+    reply_end(src);
+}
+
+//"?": all parameters in one line, the same format as the input
+void cmd_param_dump(cmd_source_t &src)
 {
-    int lbc;
-    int ubc;
-    int lowerpwm;
-    int upperpwm;
-    long countinternnow = 0;
-    long countinternprev = 0;
-    int normaliz = 1;
-    float GLED = 0.0;
-    int dac_case_local;
+    reply_begin(src);
+    src.io->print("OK");
+    for (int i = 0; i < CMD_PARAMS; i++)
+    {
+        src.io->print(" ");
+        src.io->print(cmd_params[i].key);
+        src.io->print("=");
+        if (cmd_params[i].f != NULL)
+        {
+            src.io->print(*cmd_params[i].f, 4);
+        }
+        else
+        {
+            src.io->print((long)*cmd_params[i].i);
+        }
+    }
+    src.io->print("\n");
+    reply_end(src);
+}
 
-    for (;;)
+//"max_break=21000 min_break=1500 gammafac=1.2 save": all checked first, then all set at once between two samples
+//nothing is set if one pair is wrong, "save" also queues the flash write
+void cmd_param_batch(cmd_source_t &src)
+{
+    if (strcmp(src.line, "?") == 0)
     {
-        bool p2u = false;
+        cmd_param_dump(src);
+        return;
+    }
 
-        xSemaphoreTake(Semaphore, portMAX_DELAY);
-        p2u = open2use;
-        xSemaphoreGive(Semaphore);
+    cmd_kv_t kv[CMD_KV_MAX];
+    int n = cmd_split(src.line, kv, CMD_KV_MAX);
+    if (n < 0)
+    {
+        cmd_reply(src, "ERR", "too_many", NULL);
+        return;
+    }
 
-        if (p2u)
+    int index[CMD_KV_MAX];
+    float value[CMD_KV_MAX];
+    int set = 0;
+    bool save = false;
+    for (int k = 0; k < n; k++)
+    {
+        if (kv[k].value == NULL)
         {
-            if (normaliz == 0)
-            {
-                xSemaphoreTake(Semaphore, portMAX_DELAY);
-                GLED = GLED_global;
-                countinternnow = count;
-                normaliz = normalization;
-                xSemaphoreGive(Semaphore);
-            }
-            else if (normaliz == 1)
-            {
-                xSemaphoreTake(Semaphore, portMAX_DELAY);
-                lbc = lowerbitcase;
-                ubc = upperbitcase;
-                lowerpwm = lower2pwm;
-                upperpwm = upper2pwm;
-                countinternnow = count;
-                normaliz = normalization;
-                dac_case_local = dac_case_global;
-                xSemaphoreGive(Semaphore);
-            }
-
-            else if (normaliz == 2)
+            if (strcmp(kv[k].key, "save") != 0)
             {
-                xSemaphoreTake(Semaphore, portMAX_DELAY);
-                normaliz = normalization;
-                xSemaphoreGive(Semaphore);
+                cmd_reply(src, "ERR", "key", kv[k].key);
+                return;
             }
+            save = true;
+            continue;
         }
 
-        if ((countinternnow - countinternprev) == 2)
+        int i = cmd_param_find(kv[k].key);
+        if (i < 0)
         {
-            print_serial_and_bt(" ", 1);
-            print_serial_and_bt("Lost 1 value", 0);
-            print_serial_and_bt(" ", 1);
+            cmd_reply(src, "ERR", "key", kv[k].key);
+            return;
         }
-        if ((countinternnow - countinternprev) == 3)
+        float v;
+        if (!num_parse(kv[k].value, v) || v < cmd_params[i].min || v > cmd_params[i].max)
         {
-            print_serial_and_bt(" ", 1);
-            print_serial_and_bt("Lost 2 value", 0);
-            print_serial_and_bt(" ", 1);
+            cmd_reply(src, "ERR", "value", kv[k].key);
+            return;
         }
-        if ((countinternnow - countinternprev) == 4)
+        index[set] = i;
+        value[set] = v;
+        set++;
+    }
+
+    //dead zone below 100%, with the values after this batch
+    float new_min = min_break, new_max = max_break;
+    for (int k = 0; k < set; k++)
+    {
+        if (cmd_params[index[k]].f == &min_break)
         {
-            print_serial_and_bt(" ", 1);
-            print_serial_and_bt("Lost 3 value", 0);
-            print_serial_and_bt(" ", 1);
+            new_min = value[k];
         }
-        if ((countinternnow - countinternprev) > 4)
+        else if (cmd_params[index[k]].f == &max_break)
         {
-            print_serial_and_bt(" ", 1);
-            print_serial_and_bt("Lost over 3 value", 0);
-            print_serial_and_bt(" ", 1);
+            new_max = value[k];
         }
+    }
+    if (new_min >= new_max)
+    {
+        cmd_reply(src, "ERR", "value", "min_break");
+        return;
+    }
 
-        countinternprev = countinternnow;
-
-        if (normaliz == 0)
-        {
-
-            dacWrite(DAC1, round(GLED));
-        }
-        else if (normaliz == 1)
+    //the new profile is compiled into the spare buffer before the lock, from a copy with the batch values
+    bool monotone = true;
+    if (set > 0)
+    {
+        brake_profile_t p = flash_cfg.profiles[active_profile];
+        profile_from_ram(p);
+        for (int k = 0; k < set; k++)
         {
-            if (dac_case_local == 1 || dac_case_local == 2 ||
-                dac_case_local == 3 || dac_case_local == 4 ||
-                dac_case_local == 5 || dac_case_local == 7)
-            {
-                dacWrite(DAC1, lbc);
-            }
-            else if (dac_case_local == 6)
-            {
-                dacWrite(DAC1, ubc);
-            }
-
-            else if (dac_case_local == 8)
+            const cmd_param_t &cp = cmd_params[index[k]];
+            if (cp.prof < 0)
             {
-                int x;
-                for (x = 1; x <= upperpwm; x++)
-                {
-                    dacWrite(DAC1, ubc);
-                }
-                for (x = 1; x <= lowerpwm; x++)
-                {
-                    dacWrite(DAC1, lbc);
-                }
+                continue;
             }
-            else if (dac_case_local == 9)
+            uint8_t *field = (uint8_t *)&p + cp.prof; //packed struct => memcpy
+            if (cp.f != NULL)
             {
-                int x;
-                for (x = 1; x <= lowerpwm; x++)
-                {
-                    dacWrite(DAC1, lbc);
-                }
-                for (x = 1; x <= upperpwm; x++)
-                {
-                    dacWrite(DAC1, ubc);
-                }
+                float f = value[k];
+                memcpy(field, &f, sizeof(f));
             }
-            else if (dac_case_local == 10)
+            else
             {
-                int x;
-                for (x = 1; x <= (lowerpwm + upperpwm); x++)
-                {
-                    if ((x % 2) == 0)
-                    {
-                        dacWrite(DAC1, ubc);
-                    }
-                    else
-                    {
-                        dacWrite(DAC1, lbc);
-                    }
-                }
+                int32_t n = lround(value[k]);
+                memcpy(field, &n, sizeof(n));
             }
         }
+        monotone = profile_prepare(p, flash_cfg.curves[active_profile]);
     }
-}
-
-float calulate_dac_raw(float loadcellcleaned)
-{
-    float reduces_break;
-    float GLED;
 
-    //if max break to much, reduce not input side but output side adjust the voltage
-    if (volt_direction_normal == true)
+    xSemaphoreTake(Acquire, portMAX_DELAY); //not during a sample
+    for (int k = 0; k < set; k++)
+    {
+        const cmd_param_t &cp = cmd_params[index[k]];
+        if (cp.f != NULL)
+        {
+            *cp.f = value[k];
+        }
+        else
+        {
+            *cp.i = lround(value[k]);
+        }
+    }
+    if (set > 0)
     {
-        reduces_break = (float)max_break_volt * (max_break_redfac / 100.0); // example max_break_volt*0.80
+        profile_swap(active_profile); //the output task takes the new profile with the next sample
+        filter_setup();
     }
-    else
+    xSemaphoreGive(Acquire);
+    if (!monotone)
     {
-        reduces_break = (float)max_break_volt * ((100.0 + (100.0 - max_break_redfac)) / 100.0); // example max_break_volt*1.20
+        print_serial_and_bt("Force curve not monotone, gamma used", 1);
     }
 
-    if (loadcellcleaned > min_break && loadcellcleaned < max_break)
+    if (save)
     {
-        GLED = mapping(loadcellcleaned, min_break, max_break, min_break_volt, reduces_break); //LED need approx 160 as min value to shine
+        config_from_ram(flash_cfg);
+        config_store_save(flash_cfg);
+    }
 
-        //give the needed voltage to given load=break force
-        //dacWrite(DAC1, round(GLED));
+    reply_begin(src);
+    src.io->print("OK ");
+    src.io->print((long)set);
+    src.io->print(save ? " saved\n" : "\n");
+    reply_end(src);
+}
+
+//single commands, the same for Serial and BT ("w" is the short form of "www")
+//each one ends with "OK <command>" or "ERR <reason> <command>" after its text
+void command_dispatch(cmd_source_t &src)
+{
+    const char *inByte = src.line;
+    const char *error = NULL;
+    if (strcmp(inByte, "t") == 0)
+    {
+        pause_multitask();
+        tara_load_cell(); //tare
+        restart_multitask();
     }
-    else
+    else if (strcmp(inByte, "c") == 0)
+    {
+        pause_multitask();
+        calibrate(); //break calibrate
+        restart_multitask();
+    }
+    else if (strcmp(inByte, "v") == 0)
+    {
+        pause_multitask();
+        voltage_cali(); //voltage calibrate
+        restart_multitask();
+    }
+    else if (strcmp(inByte, "e") == 0)
+    {
+        pause_multitask();
+        load_variables_flash(1); //read out flash
+        restart_multitask();
+    }
+    else if (strcmp(inByte, "a") == 0)
+    {
+        pause_multitask();
+        load_variables_flash(0); //read out RAM
+        restart_multitask();
+    }
+    else if (strcmp(inByte, "www") == 0 || strcmp(inByte, "w") == 0)
+    {
+        pause_multitask();
+        weight_reference_calibration_first_time(); //calibrate basis weight
+        restart_multitask();
+    }
+    else if (strcmp(inByte, "s") == 0)
+    {
+        pause_multitask();
+        SDPrint(); //calibrate basis weight
+        restart_multitask();
+    }
+    else if (strcmp(inByte, "l") == 0)
+    {
+        pause_multitask();
+        change_breake_load_values(); //calibrate basis weight
+        restart_multitask();
+    }
+    else if (strcmp(inByte, "r") == 0)
+    {
+        pause_multitask();
+        reboot_mc(); //calibrate basis weight
+        restart_multitask();
+    }
+    else if (strcmp(inByte, "n") == 0)
+    {
+        pause_multitask();
+        normalisation();
+        restart_multitask();
+    }
+    else if (strcmp(inByte, "i") == 0)
+    {
+        pause_multitask();
+        simulation_esp32();
+        restart_multitask();
+    }
+    else if (strcmp(inByte, "k") == 0)
+    {
+        pause_multitask();
+        creep_cali();
+        restart_multitask();
+    }
+    else if (strcmp(inByte, "m") == 0)
+    {
+        pause_multitask();
+        multi_point_calibration();
+        restart_multitask();
+    }
+    else if (strcmp(inByte, "g") == 0)
+    {
+        pause_multitask();
+        game_linearization_capture();
+        restart_multitask();
+    }
+    else if (strlen(inByte) == 2 && inByte[0] == 'p' && isDigit(inByte[1]))
     {
-        if (volt_direction_normal == true)
+        if (!profile_switch(inByte[1] - '1')) //no pause, the output keeps running
         {
-            if (loadcellcleaned <= min_break)
-            {
-                GLED = (float)min_break_volt - 3.0;
-                //bitcheckfloat(GLED, (float)minbit, (float)maxbit);
-            }
-            else if (loadcellcleaned >= max_break)
-            {
-                GLED = (float)reduces_break + 3.0;
-                //bitcheckfloat(GLED, (float)minbit, (float)maxbit);
-            }
+            error = "value";
         }
-        else
+    }
+    else if (strcmp(inByte, "h") == 0)
+    {
+        pause_multitask();
+        filter_cali();
+        restart_multitask();
+    }
+    else if (inByte[0] == 'f')
+    {
+        if (!force_curve_command(inByte)) //no pause, the output keeps running
         {
-            if (loadcellcleaned <= min_break)
-            {
-                GLED = (float)min_break_volt + 3.0;
-                //bitcheckfloat(GLED, (float)minbit, (float)maxbit);
-            }
-            else if (loadcellcleaned >= max_break)
-            {
-                GLED = (float)reduces_break - 3.0;
-                //bitcheckfloat(GLED, (float)minbit, (float)maxbit);
-            }
+            error = "value";
         }
-
-        //dacWrite(DAC1, round(GLED));
+    }
+    else if (strcmp(inByte, "p") == 0)
+    {
+        pause_multitask();
+        profile_menu();
+        restart_multitask();
+    }
+    else if (strcmp(inByte, "u") == 0)
+    {
+        task_report(); //no pause, the costs are measured while running
+    }
+    else if (strcmp(inByte, "b") == 0)
+    {
+        bt_toggle();
+    }
+    else if (strcmp(inByte, "j") == 0)
+    {
+        jitter_report();
+    }
+    else if (strcmp(inByte, "q") == 0)
+    {
+        handoff_report();
+    }
+    else if (strcmp(inByte, "o") == 0)
+    {
+        print_serial_and_bt("***", 1);
+        out_report();
+        print_serial_and_bt("***", 1);
+    }
+    else if (strcmp(inByte, "os") == 0)
+    {
+        out_toggle(serial_sink);
+    }
+    else if (strcmp(inByte, "ob") == 0)
+    {
+        out_toggle(bt_sink);
+    }
+    else
+    {
+        error = "unknown";
     }
 
-    int GLEDTEMP = int(GLED + 0.5);
-    bitcheckint(GLEDTEMP, minbit, maxbit);
-    return (float)GLEDTEMP;
+    if (error != NULL)
+    {
+        cmd_reply(src, "ERR", error, inByte);
+    }
+    else
+    {
+        cmd_reply(src, "OK", NULL, inByte);
+    }
 }
 
-void calculate_dac_normalizated(float loadcellcleaned,
-                                float &weight_in_percent,
-                                int &lower_bit_case, int &upper_bit_case,
-                                int &lower_pwm, int &upper_pwm,
-                                int &dac_case)
-{
-
-    float lower_delta = 0.0001;
-    float upper_delta = 0.9999;    
+//config snapshot: the whole blob as in flash (header with CRC + brake_config_t) in one transfer, tools/cfg_clone
+#define SNAPSHOT_TIMEOUT_MS 3000 //the blob has to follow "READY" within this time
+uint8_t snapshot_buf[CONFIG_BLOB_MAX]; //too big for the command task stack
+brake_config_t snapshot_cfg;
 
-    ////////////////// new from 29.12.2020 for the linearization
-    weight_in_percent = mapping(loadcellcleaned, min_break, max_break, 0.0, (max_break_redfac / 100.0)); //mapping into %
+//"cfg_get": "BIN <length>" and the blob
+void config_snapshot_get(cmd_source_t &src)
+{
+    config_from_ram(flash_cfg); //flash_cfg also holds the tare, the other profiles and the force curves
+    size_t len = config_blob_build(flash_cfg, 0, snapshot_buf);
+
+    reply_begin(src); //no text of the drain task inside the blob
+    src.io->print("BIN ");
+    src.io->print((long)len);
+    src.io->print("\n");
+    src.io->write(snapshot_buf, len);
+    reply_end(src);
+}
 
-    //gamma>2.0 means break at 50% is now  71% (faster break curve)
-    //gamma<0.5 means break at 50% is now just 25%  (slower break curve)
-    if (gammafac != 1.0) //1.0 linear no change needed
+//"cfg_put <length>": "READY", then the blob, checked and set at once between two samples and saved
+//the tare of this rig stays, the one of the other load cell is no use here
+void config_snapshot_put(cmd_source_t &src, long len)
+{
+    if (len < (long)sizeof(config_header_t) || len > (long)CONFIG_BLOB_MAX)
     {
-        weight_in_percent = pow(weight_in_percent, (1.0 / gammafac)); //change curve after gamma factor
+        cmd_reply(src, "ERR", "length", NULL);
+        return;
     }
+    cmd_reply(src, "READY", NULL, NULL);
 
-    int lower_band_case;  //acctual case N from load_percent[N] array value // same as load_case just one after
-    int upper_band_case;  // same as load_case just one before
-    float lower_band_per; // same as load_case but the value from the array load_percent[] after
-    float upper_band_per; // same as load_case but the value from the array load_percent[] before
-    float delta;          // delta between lower and upper value
-
-    if (weight_in_percent >= lower_delta && weight_in_percent <= upper_delta) // for 0 or 1 we do not need to check
-    {
-        for (int n = (laod_percent_steps - 1); n >= 0; n--) // n=0 =>100%
-        {
-            if (weight_in_percent > load_percent[n])
-            {
-                lower_band_case = n;     //take the hightest value until the next load_percent(n-1) is bigger then weight_in_percent
-                upper_band_case = n - 1; //would be the next value but is bigger then the weight_in_percent
-            }
-            if (weight_in_percent <= load_percent[n])
-            {
-                lower_band_per = load_percent[lower_band_case];
-                if (upper_band_case < 0) //min value in array is 0
-                {
-                    upper_band_per = load_percent[lower_band_case];
-                }
-                else
-                {
-                    upper_band_per = load_percent[upper_band_case];
-                }
-                break; // and when it is less we go out and have the load_case
-            }
-        }
-    }
-    else if (weight_in_percent < lower_delta || weight_in_percent > upper_delta) // for 0 or 1 we do not need to check
+    long n = 0;
+    unsigned long start = millis();
+    while (n < len && millis() - start < SNAPSHOT_TIMEOUT_MS)
     {
-        if (weight_in_percent < lower_delta)
+        int ch = src.io->available() > 0 ? src.io->read() : -1;
+        if (ch < 0)
         {
-            lower_band_case = (laod_percent_steps - 1); //78 (0 to 78 = 79 steps)
-            upper_band_case = (laod_percent_steps - 1); //78
-            lower_band_per = load_percent[lower_band_case];
-            upper_band_per = load_percent[upper_band_case];
+            vTaskDelay(1);
+            continue;
         }
-        if (weight_in_percent > upper_delta)
+        if (n == 0 && (ch == '\n' || ch == '\r'))
         {
-            lower_band_case = 0; //0
-            upper_band_case = 0; //0
-            lower_band_per = load_percent[lower_band_case];
-            upper_band_per = load_percent[upper_band_case];
+            continue; //rest of the line end of the command, the blob starts with the magic
         }
+        snapshot_buf[n++] = ch;
+    }
+    if (n < len)
+    {
+        cmd_reply(src, "ERR", "timeout", NULL);
+        return;
+    }
+
+    snapshot_cfg = flash_cfg; //fields not in an older blob stay
+    uint32_t sequence;
+    int result = config_blob_parse(snapshot_buf, n, snapshot_cfg, sequence);
+    if (result != CONFIG_BLOB_OK)
+    {
+        cmd_reply(src, "ERR", result == CONFIG_BLOB_CRC ? "crc" : (result == CONFIG_BLOB_HEADER ? "header" : "value"), NULL);
+        return;
+    }
+    snapshot_cfg.tare_offset = flash_cfg.tare_offset;
+    snapshot_cfg.tare_noise = flash_cfg.tare_noise;
+
+    int waiting = config_prepare(snapshot_cfg); //the 512 point tables before the lock
+    xSemaphoreTake(Acquire, portMAX_DELAY); //not during a sample
+    flash_cfg = snapshot_cfg;
+    config_apply(flash_cfg, waiting); //the running profile swapped in
+    LoadCell.setCalFactor(newCalibrationValue);
+    xSemaphoreGive(Acquire);
+    if (waiting < 0)
+    {
+        print_serial_and_bt("Force curve not monotone, gamma used", 1);
     }
+    config_store_save(flash_cfg);
 
-    float lower_weighted_percent; //the distance from value
-    float upper_weighted_percent; //the distance from value
-    float pwm = 10.0;             //max cylce or loops before next calulatuion
+    reply_begin(src);
+    src.io->print("OK ");
+    src.io->print(n);
+    src.io->print(" saved\n");
+    reply_end(src);
+}
 
-    delta = abs(upper_band_per - lower_band_per);
-    if (delta > 0.0001) //no ZERO in deviding and use a bit higher value then zero not to get an huge value out
+void config_snapshot_command(cmd_source_t &src)
+{
+    if (strcmp(src.line, "cfg_get") == 0)
     {
-        lower_weighted_percent = 1.0 - (abs(weight_in_percent - lower_band_per) / delta);
-        upper_weighted_percent = 1.0 - (abs(weight_in_percent - upper_band_per) / delta);
-        lower_pwm = int(pwm * lower_weighted_percent + 0.5); // example 80% gives 8 times PWM and use the int(value +0.5) to round correctly
-        upper_pwm = int(pwm * upper_weighted_percent + 0.5); // example 20% give 2 times PWM
+        config_snapshot_get(src);
     }
-    else
+    else if (strncmp(src.line, "cfg_put ", 8) == 0)
     {
-        lower_weighted_percent = 0.0;
-        upper_weighted_percent = 0.0;
-        lower_pwm = 0; // example 0 times PWM
-        upper_pwm = 0; // example 0 times PWM
+        config_snapshot_put(src, strtol(src.line + 8, NULL, 10));
     }
-    //extra control on outer band points
-    if (weight_in_percent < lower_delta || weight_in_percent > upper_delta)
+    else
     {
-        lower_weighted_percent = 0.0;
-        upper_weighted_percent = 0.0;
-        lower_pwm = 0; // example 0 times PWM
-        upper_pwm = 0; // example 0 times PWM
+        cmd_reply(src, "ERR", "key", src.line);
     }
+}
 
-    //Here we calulate the Voltage for the load
-    if (weight_in_percent >= lower_delta || weight_in_percent <= upper_delta)
+//one complete line from a stream: key=value batch, config snapshot or command
+void command_source_service(cmd_source_t &src)
+{
+    if (!cmd_read_line(src))
+    {
+        return;
+    }
+    if (cmd_is_kv(src.line))
     {
-        //calulating cooresponing bit to load = linearisation of load to output => 50% load gives 50% break in PS4
-        //and use the int(value +0.5) to round correctly
-        lower_bit_case = int(mapping(lower_band_case, (laod_percent_steps - 1), 0, min_break_volt, max_break_volt) + 0.5);
-        upper_bit_case = int(mapping(upper_band_case, (laod_percent_steps - 1), 0, min_break_volt, max_break_volt) + 0.5);
+        cmd_param_batch(src);
+    }
+    else if (strncmp(src.line, "cfg_", 4) == 0)
+    {
+        config_snapshot_command(src);
     }
     else
     {
-        if (weight_in_percent < lower_delta)
-        {
-            lower_bit_case = min_break_volt;
-            upper_bit_case = min_break_volt;
-        }
-        if (weight_in_percent > upper_delta)
-        {
-            lower_bit_case = max_break_volt;
-            upper_bit_case = max_break_volt;
-        }
+        command_dispatch(src);
     }
+}
 
-    //security check that we have right range 0 -255
-    bitcheckint(lower_bit_case, minbit, maxbit);
-    bitcheckint(upper_bit_case, minbit, maxbit);
+void serial_available()
+{
+    // receive command from serial terminal and bluetooth
+    command_source_service(serial_cmd);
+    command_source_service(bt_cmd);
+}
 
-    //#################################################################
-    //#################################################################
-    //#################################################################
-    //#################################################################
-    if (lower_bit_case == min_break_volt || lower_bit_case == max_break_volt) //max or min break
-    {
-        if (volt_direction_normal == true)
-        {
-            if (lower_bit_case == min_break_volt) //min break
-            {
-                lower_bit_case = min_break_volt - 3; //give 3 bit less at the min/max ends
-                upper_bit_case = min_break_volt - 3; //give 3 bit more at the min/max ends
-                //security check that we have right range
-                bitcheckint(lower_bit_case, minbit, maxbit);
-                bitcheckint(upper_bit_case, minbit, maxbit);
+//boot stages, the DAC is driven with the 0% break voltage in all of them
+#define BOOT_CHECK 0     //first conversions, compare them with the stored tare
+#define BOOT_STABILIZE 1 //HX711 converting, waiting for the stabilizing time
+#define BOOT_TARE 2      //tareNoDelay() running in the background
+#define BOOT_READY 3     //tare done or restored, load cell data is valid
+
+#define BOOT_CHECK_SAMPLES 8   //smoothed values compared with the stored tare
+#define BOOT_CHECK_ROUNDS 5    //windows sampled again while the load moves, then the stored tare is kept
+#define TARE_NOISE_FAC 4.0f    //allowed deviation in multiples of the stored noise
+#define TARE_DEADZONE_FAC 0.25f //plus this part of the min_break dead zone
+
+const long stabilizingtime = 2000; // preciscion right after power-up can be improved by adding a few seconds of stabilizing time
+
+int boot_stage = BOOT_CHECK;
+bool boot_signal_timeout = false;   //HX711 not answering during boot
+bool boot_saturated = false;        //HX711 at its limit during boot
+unsigned long boot_dac_valid_us = 0; //micros() since reset when the DAC did get the 0% break voltage
+unsigned long boot_first_sample_us = 0; //micros() since reset when the first valid load sample was published
+
+int boot_conversions = 0;   //conversions since LoadCell.begin()
+float boot_check_sum = 0.0f;
+float boot_check_min = 0.0f;
+float boot_check_max = 0.0f;
+int boot_check_round = 1;
+float boot_noise_raw = -1.0f; //spread of the boot check window in raw counts, -1 = not measured
+
+//decide after the check window: use the stored tare or do a new one
+void boot_check_decide()
+{
+    float mean = boot_check_sum / BOOT_CHECK_SAMPLES;
+    float spread = boot_check_max - boot_check_min;
+    float calfac = fabs(LoadCell.getCalFactor());
+    float noise = flash_cfg.tare_noise / calfac; //stored fingerprint in load units
+    float tolerance = TARE_NOISE_FAC * noise + TARE_DEADZONE_FAC * min_break;
 
-                dac_case = 1;
-                //dacWrite(DAC1, lower_bit_case);
-            }
-            else if (lower_bit_case == max_break_volt) //max break
-            {
-                lower_bit_case = max_break_volt + 3; //give 3 bit more at the min/max ends
-                upper_bit_case = max_break_volt + 3; //give 3 bit less at the min/max ends
-                //security check that we have right range
-                bitcheckint(lower_bit_case, minbit, maxbit);
-                bitcheckint(upper_bit_case, minbit, maxbit);
-                dac_case = 2;
-                //dacWrite(DAC1, lower_bit_case);
-            }
-        }
-        else
-        {
-            if (lower_bit_case == min_break_volt) //min break
-            {
-                lower_bit_case = min_break_volt + 3; //give 2 bit more
-                upper_bit_case = min_break_volt + 3;
-                //security check that we have right range
-                bitcheckint(lower_bit_case, minbit, maxbit);
-                bitcheckint(upper_bit_case, minbit, maxbit);
-                dac_case = 3;
-                //dacWrite(DAC1, lower_bit_case);
-            }
-            else if (lower_bit_case == max_break_volt) //max break
-            {
-                lower_bit_case = max_break_volt - 3; //give 2 bit less
-                upper_bit_case = max_break_volt - 3;
-                //security check that we have right range
-                bitcheckint(lower_bit_case, minbit, maxbit);
-                bitcheckint(upper_bit_case, minbit, maxbit);
-                dac_case = 4;
-                //dacWrite(DAC1, lower_bit_case);
-            }
-        }
+    boot_noise_raw = spread * calfac;
+
+    if (flash_cfg.tare_offset == 0)
+    {
+        boot_stage = BOOT_STABILIZE; //nothing stored, normal tare
+    }
+    else if (spread > tolerance && boot_check_round < BOOT_CHECK_ROUNDS)
+    {
+        //the load moves (foot going on the pedal): the mean says nothing yet, sample the next window
+        boot_check_round++;
+        boot_conversions = DATA_SET;
+        boot_check_sum = 0.0f;
+    }
+    else if (spread > tolerance)
+    {
+        //still moving: a tare now would zero the foot, keep the stored zero
+        print_serial_and_bt("Load not quiet at power-on, stored tare used", 1);
+        boot_stage = BOOT_READY;
     }
-    else if (lower_pwm == 0 && upper_pwm == 0 && lower_bit_case > min_break_volt && lower_bit_case < max_break_volt) //value == in the array, not above or lower, but exactly
+    else if (fabs(mean) <= tolerance)
     {
-        //dacWrite(DAC1, lower_bit_case);
-        dac_case = 5;
+        //same zero as last time and quiet: keep it and skip the tare
+        print_serial_and_bt("Stored tare restored", 1);
+        boot_stage = BOOT_READY;
     }
-    else if (lower_pwm == 0 && upper_pwm > 0)
+    else if (mean > tolerance)
     {
-        //dacWrite(DAC1, upper_bit_case);
-        dac_case = 6;
+        //load on the cell at power-on, a tare now would zero the foot: keep the stored zero
+        print_serial_and_bt("Pedal loaded at power-on, stored tare used", 1);
+        boot_stage = BOOT_READY;
     }
-    else if (lower_pwm > 0 && upper_pwm == 0)
+    else
     {
-        //dacWrite(DAC1, lower_bit_case);
-        dac_case = 7;
+        //quiet and unloaded, but the zero did drift => new tare
+        print_serial_and_bt("Stored tare out of tolerance, new tare", 1);
+        boot_stage = BOOT_STABILIZE;
     }
-    else if (lower_pwm > 0 && upper_pwm > 0) //PWM part of the DAC
+}
+
+//runs in the loop until the load cell is ready, does not block
+void boot_service()
+{
+    bool new_conversion = (LoadCell.update() != 0);
+
+    if (LoadCell.getSignalTimeoutFlag() && boot_signal_timeout == false)
     {
-        if (lower_pwm > upper_pwm)
-        {
-            /* for (x = 1; x <= upper_pwm; x++)
-            {
-                dacWrite(DAC1, upper_bit_case);
-            }
-            for (x = 1; x <= lower_pwm; x++)
-            {
-                dacWrite(DAC1, lower_bit_case);
-            }*/
-            dac_case = 8;
-        }
-        if (lower_pwm < upper_pwm)
+        boot_signal_timeout = true; //keep the 0% break output, just tell it once
+        print_serial_and_bt("Timeout, check MCU>HX711 wiring and pin designations", 1);
+    }
+
+    if (LoadCell.getSaturatedSamples() > 0 && boot_saturated == false)
+    {
+        boot_saturated = true; //the boot goes on with the limit values, just tell it once
+        print_serial_and_bt("HX711 at its limit, check the load cell wiring (E+, E-, A+, A-)", 1);
+    }
+
+    if (boot_stage == BOOT_CHECK)
+    {
+        if (boot_conversions == 0)
         {
-            /*for (x = 1; x <= lower_pwm; x++)
-            {
-                dacWrite(DAC1, lower_bit_case);
-            }
-            for (x = 1; x <= upper_pwm; x++)
-            {
-                dacWrite(DAC1, upper_bit_case);
-            }*/
-            dac_case = 9;
+            LoadCell.setTareOffset(flash_cfg.tare_offset); //getData() is now the load to the stored zero
         }
-        if (lower_pwm == upper_pwm)
+        //400ms is min. settling time of the HX711, then one full dataset before the values are used
+        if (new_conversion && millis() > 400)
         {
-            /*for (x = 1; x <= (lower_pwm + upper_pwm); x++)
+            boot_conversions++;
+            int n = boot_conversions - DATA_SET;
+            if (n > 0)
             {
-                if ((x % 2) == 0)
+                float load = LoadCell.getData();
+                if (n == 1)
                 {
-                    dacWrite(DAC1, upper_bit_case);
+                    boot_check_min = load;
+                    boot_check_max = load;
                 }
-                else
+                boot_check_sum += load;
+                boot_check_min = min(boot_check_min, load);
+                boot_check_max = max(boot_check_max, load);
+                if (n == BOOT_CHECK_SAMPLES)
                 {
-                    dacWrite(DAC1, lower_bit_case);
+                    boot_check_decide();
                 }
-            }*/
-            dac_case = 10;
+            }
         }
     }
-}
-
-void serial_available()
-{
-    // receive command from serial terminal
-    if (Serial.available() > 0)
+    else if (boot_stage == BOOT_STABILIZE && millis() > (unsigned long)(stabilizingtime + 400))
     {
-        String inByte = Serial.readStringUntil('\n');
-        if (inByte == "t")
-        {
-            pause_multitask();
-            tara_load_cell(); //tare
-            restart_multitask();
-        }
-        else if (inByte == "c")
-        {
-            pause_multitask();
-            calibrate(); //break calibrate
-            restart_multitask();
-        }
-        else if (inByte == "v")
-        {
-            pause_multitask();
-            voltage_cali(); //voltage calibrate
-            restart_multitask();
-        }
-        else if (inByte == "e")
-        {
-            pause_multitask();
-            load_variables_eeprom(1); //read out eeprom
-            restart_multitask();
-        }
-        else if (inByte == "a")
-        {
-            pause_multitask();
-            load_variables_eeprom(0); //read out RAM
-            restart_multitask();
-        }
-        else if (inByte == "www")
-        {
-            pause_multitask();
-            weight_reference_calibration_first_time(); //calibrate basis weight
-            restart_multitask();
-        }
-        else if (inByte == "s")
-        {
-            pause_multitask();
-            SDPrint(); //calibrate basis weight
-            restart_multitask();
-        }
-        else if (inByte == "l")
-        {
-            pause_multitask();
-            change_breake_load_values(); //calibrate basis weight
-            restart_multitask();
-        }
-        else if (inByte == "r")
-        {
-            pause_multitask();
-            reboot_mc(); //calibrate basis weight
-            restart_multitask();
-        }
-        else if (inByte == "n")
-        {
-            pause_multitask();
-            normalisation();
-            restart_multitask();
-        }
-        else if (inByte == "i")
-        {
-            pause_multitask();
-            simulation_esp32();
-            restart_multitask();
-        }
+        tara_load_cell(); // tara load cells
+        boot_stage = BOOT_TARE;
     }
-
-    if (SerialBT.available())
+    else if (boot_stage == BOOT_TARE && LoadCell.getTareStatus() == true)
     {
-        char BTByte = SerialBT.read();
-        if (BTByte == 't')
-        {
-            pause_multitask();
-            tara_load_cell(); //tare
-            restart_multitask();
-        }
-        else if (BTByte == 'c')
-        {
-            pause_multitask();
-            calibrate(); //break calibrate
-            restart_multitask();
-        }
-        else if (BTByte == 'v')
-        {
-            pause_multitask();
-            voltage_cali(); //voltage calibrate
-            restart_multitask();
-        }
-        else if (BTByte == 'e')
-        {
-            pause_multitask();
-            load_variables_eeprom(1); //read out eeprom
-            restart_multitask();
-        }
-        else if (BTByte == 'a')
-        {
-            pause_multitask();
-            load_variables_eeprom(0); //read out RAM
-            restart_multitask();
-        }
-        else if (BTByte == 'w')
-        {
-            pause_multitask();
-            weight_reference_calibration_first_time(); //calibrate basis weight
-            restart_multitask();
-        }
-        else if (BTByte == 's')
-        {
-            pause_multitask();
-            SDPrint(); //serial print
-            restart_multitask();
-        }
-        else if (BTByte == 'l')
-        {
-            pause_multitask();
-            change_breake_load_values(); //calibrate basis weight
-            restart_multitask();
-        }
-        else if (BTByte == 'r')
-        {
-            pause_multitask();
-            reboot_mc(); //calibrate basis weight
-            restart_multitask();
-        }
-        else if (BTByte == 'n')
-        {
-            pause_multitask();
-            normalisation();
-            restart_multitask();
-        }
-        else if (BTByte == 'i')
-        {
-            pause_multitask();
-            simulation_esp32();
-            restart_multitask();
-        }
+        save_tare_flash(boot_noise_raw);
+        boot_stage = BOOT_READY;
     }
-}
-
-void setup()
-{
-    Serial.begin(115200);
-    delay(10);
-
-    SerialBT.begin("ESP32_G29_BreakSys"); //Bluetooth device name
-
-    // Options are: 240 (default), 160, 80, 40, 20 and 10 MHz
-    setCpuFrequencyMhz(80); //Set CPU clock to 80MHz fo example
-    getCpuFrequencyMhz();   //Get CPU clock
-
-    print_serial_and_bt("", 1);
-    print_serial_and_bt("CPU Mhz: ", 0);
-    print_serial_and_bt(String(getCpuFrequencyMhz()), 0); //Get CPU clock)
-    print_serial_and_bt("", 1);
-
-    print_serial_and_bt("The device started, now you can pair it with bluetooth!", 1);
 
-    print_serial_and_bt("", 1);
-    print_serial_and_bt("Starting...", 1);
-
-    //file name of the sketch to have some controll over the sketches
-    ino = (ino.substring((ino.indexOf(".")), (ino.lastIndexOf("\\")) + 1));
-
-    LoadCell.begin();
-    long stabilizingtime = 2000; // preciscion right after power-up can be improved by adding a few seconds of stabilizing time
-    boolean _tare = false;       //set this to false if you don't want tare to be performed in the next step
-    LoadCell.start(stabilizingtime, _tare);
-    if (LoadCell.getTareTimeoutFlag() || LoadCell.getSignalTimeoutFlag())
-    {
-        print_serial_and_bt("Timeout, check MCU>HX711 wiring and pin designations", 1);
-        while (1)
-            ;
-    }
-    else
+    if (boot_stage == BOOT_READY)
     {
-        LoadCell.setCalFactor(1.0); // user set calibration value (float), initial value 1.0 may be used for this sketch
         print_serial_and_bt("Startup is complete", 1);
     }
+}
 
-    tara_load_cell(); // tara load cells
-    delay(2000);
-
-    load_variables_eeprom(1); //load in the variables
-    delay(3000);
-
-    // Create the queue with 5 slots of 2 bytes
-    // queue = xQueueCreate(10, sizeof(int));
-
-    // Simple flag, up or down
-    Semaphore = xSemaphoreCreateMutex();
-
-    xTaskCreatePinnedToCore(
-        pwm2dac, /* Function to implement the task */
-        "Task0", /* Name of the task */
-        4096,    /* Stack size in words */
-        NULL,    /* Task input parameter */
-        1,       /* Priority of the task */
-        &Task0,  /* Task handle. */
-        1);      /* Core where the task should run */
+void boot_report()
+{
+    print_serial_and_bt("Boot DAC valid ms: ", 0);
+    print_num_serial_and_bt(boot_dac_valid_us / 1000.0, 2, 0);
+    print_serial_and_bt("  first sample ms: ", 0);
+    print_num_serial_and_bt(boot_first_sample_us / 1000.0, 2, 1);
 }
 
-void loop()
+//one pass of the acquisition task: read the conversion, filter, break curve and publish the DAC target
+void process_sample()
 {
     static boolean newDataReady = 0;
-    const int serialPrintInterval = 1000; //increase value to slow down serial print activity
     float loadcellraw;
     float loadcellcleaned;
 
@@ -1871,16 +3484,55 @@ void loop()
     if (LoadCell.update())
         newDataReady = true;
 
+    //a tare from the 't' command or the calibration is finished => the command task keeps it for the next boot
+    if (LoadCell.getTareStatus() == true)
+    {
+        tare_done = true;
+    }
+
     // get smoothed value from the dataset:
     if (newDataReady)
     {
+        rate_update(); //10 or 80 SPS board, the windows and times follow
+
         if (simulant_case == 0)
         {
             loadcellraw = LoadCell.getData();
+
+            if (filter_mode == 1) //near raw on a fast change, averaged while holding
+            {
+                loadcellraw = adaptive_filter_update(afilter, loadcellraw, filter_window());
+            }
+
+            //pedal idle and quiet => follow the drift of the zero with a limited rate
+            long az_step = auto_zero_update(autozero, loadcellraw, min_break, LoadCell.getCalFactor(), rate_sps);
+            if (az_step != 0)
+            {
+                LoadCell.setTareOffset(LoadCell.getTareOffset() + az_step);
+            }
+
+            //offset and quadratic term of the multi point calibration
+            loadcellraw = calibration_correct(loadcellraw, cal_offset, cal_quad);
+
+            if (SerialPrintData == 2) //trace before the creep compensation, to fit the creep model
+            {
+                print_num_serial_and_bt((long)millis(), 0);
+                print_serial_and_bt(",", 0);
+                print_num_serial_and_bt(loadcellraw, 2, 1);
+            }
+
+            //under a constant hold the reading creeps up, take this out before the break curve
+            loadcellraw = creep_compensate(creep, loadcellraw, creep_amplitude, creep_tau, rate_dt);
+
+            //every filter is late, extrapolate the load over its delay (not more than 100% break)
+            if (predict_on == 1)
+            {
+                loadcellraw = predictor_update(predictor, loadcellraw, rate_dt, filter_delay(rate_dt), profile_active->max_break);
+            }
         }
         else if (simulant_case == 1) //sinus curve
         {
-            delay(12);                                  //12mili approx 89Herz, speed pf my hx711 (not 80 but 89 is my speed)
+            delay(lround(1000.0f * rate_dt));           //one conversion at the measured rate (12mili at my 89Herz)
             simulate_loadcell_sinus_curve(loadcellraw); //makes new load
         }
         else if (simulant_case == 2) //100%, 75% , 50% , 25%, 0% and then up again to 100%
@@ -1892,7 +3544,7 @@ void loop()
             float load_table[9] = {100, 75, 50, 25, 0, 25, 50, 75, 100};
             long time_delta;
 
-            delay(12); //12mili approx 89Herz, speed pf my hx711 (not 80 but 89 is my speed)
+            delay(lround(1000.0f * rate_dt)); //one conversion at the measured rate (12mili at my 89Herz)
 
             if (flag_init_time == 1) //first time we use time_delta=0;
             {
@@ -1922,14 +3574,15 @@ void loop()
         }
 
         loadcellcleaned = loadcellraw;
-        count++;
+        handoff.produced++;
 
-        if (count > 1000000)
+        if (boot_first_sample_us == 0)
         {
-            count = 0;
+            boot_first_sample_us = micros();
+            boot_report();
         }
 
-        bitcheckfloat(loadcellcleaned, min_break, max_break); //cannot be less the min_break and not bigger then max_break
+        bitcheckfloat(loadcellcleaned, profile_active->min_break, profile_active->max_break); //cannot be less the min_break and not bigger then max_break
 
         /*
         //if max_break more then max_break it cant be more then max_break
@@ -1953,81 +3606,320 @@ void loop()
             //trasfare global variable in a safe way for the task part
             xSemaphoreTake(Semaphore, portMAX_DELAY);
             GLED_global = GLED;
-            count;
+            published_seq = handoff.produced; //with the value, the output task takes both or none
             normalization = normal;
+            telemetry_snap = {(long)handoff.produced, loadcellraw, GLED, 0, 0, 0, 1};
             open2use = true;
             xSemaphoreGive(Semaphore);
-            vTaskDelay(2);
-
-            if (millis() > t + serialPrintInterval)
-            {
-                if (SerialPrintData == 1)
-                {
-                    SerialPrintOutCollector(count, loadcellraw, GLED, 0, 0, 0, 1);
-                }
-
-                t = millis();
-            }
         }
         else if (normal == 1)
         {
             float weight_in_percent;
             int lower_bit_case;
-            int upper_bit_case;
-            int lower_pwm;
-            int upper_pwm;
-            int dac_case = 0;
+            float dac_target;
 
             // calulate the dac value for this case
-            calculate_dac_normalizated(loadcellcleaned, weight_in_percent, lower_bit_case, upper_bit_case, lower_pwm, upper_pwm, dac_case);
+            calculate_dac_normalizated(loadcellcleaned, weight_in_percent, lower_bit_case, dac_target);
 
             //trasfare global variable in a safe way for the task part
             // ################### DAC PART ##########################################
             // ################### This as Task Part ##########################################
             xSemaphoreTake(Semaphore, portMAX_DELAY);
-            lowerbitcase = lower_bit_case;
-            upperbitcase = upper_bit_case;
-            lower2pwm = lower_pwm;
-            upper2pwm = upper_pwm;
-            count;
+            dac_target_global = dac_target;
+            published_seq = handoff.produced; //with the value, the output task takes both or none
             normalization = normal;
             //SerialPrintDataGlobal = SerialPrintData;
             //loadcellrawglobal = loadcellraw;
             //weight_in_percent_global = weight_in_percent;
             //gammafac_global = gammafac;
-            dac_case_global = dac_case;
+            telemetry_snap = {(long)handoff.produced, loadcellraw, (float)lower_bit_case, normal, gammafac, weight_in_percent, 2};
             open2use = true;
             xSemaphoreGive(Semaphore);
-            vTaskDelay(2);
 
             //Serial.println(lower_bit_case);
             //Serial.print(" ");
+        }
 
-            if (millis() > t + serialPrintInterval)
-            {
-                if (SerialPrintData == 1)
-                {
-                    SerialPrintOutCollector(count, loadcellraw, lower_bit_case, normal, gammafac, weight_in_percent, 2);
-                }
+        newDataReady = 0;
+    }
+}
 
-                t = millis();
-            }
+//acquisition task: sleeps until the HX711 DOUT interrupt says a conversion is ready,
+//so the time from the sample to the DAC does not depend on the commands
+void acquisition(void *parameter)
+{
+    for (;;)
+    {
+        //DOUT edge, or a poll after ACQ_POLL_MS (no HX711 connected, conversion ready while paused)
+        uint32_t notified = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ACQ_POLL_MS));
+        task_wakes[TASK_ACQUIRE]++;
+        unsigned long isr_us = dout_isr_us;
+        if (notified != 0 && isr_us != 0)
+        {
+            jitter_hist_add(wake_hist, micros() - isr_us);
+        }
+        if (acquire_paused)
+        {
+            continue; //a wizard uses the load cell
         }
 
-        newDataReady = 0;
+        xSemaphoreTake(Acquire, portMAX_DELAY);
+        if (boot_stage != BOOT_READY)
+        {
+            boot_service(); //until the load cell is ready the DAC keeps the 0% break voltage from setup()
+        }
+        else
+        {
+            process_sample();
+        }
+        xSemaphoreGive(Acquire);
+
+        //the clocks of the read did toggle DOUT too, these edges are no new conversion
+        ulTaskNotifyTake(pdTRUE, 0);
+        dout_isr_us = 0;
+        if (digitalRead(HX711_dout) == LOW)
+        {
+            xTaskNotifyGive(TaskAcquire); //the next one was ready before the clear
+        }
     }
+}
 
-    if (reboot_esp32 == true) //mqtt command to reboot esp32
+//HX711 DOUT goes low = conversion ready, wake the acquisition task
+void IRAM_ATTR hx711_dout_isr()
+{
+    BaseType_t woken = pdFALSE;
+    dout_isr_us = micros();
+    xTaskNotifyFromISR(TaskAcquire, 0, eIncrement, &woken);
+    if (woken == pdTRUE)
     {
-        print_serial_and_bt("", 1);
-        print_serial_and_bt("Reboot ESP32 in 2 sec.", 0);
-        print_serial_and_bt("", 1);
+        portYIELD_FROM_ISR();
+    }
+}
+
+//command task: serial/BT commands, wizards and the flash writes, low priority
+void commands(void *parameter)
+{
+    for (;;)
+    {
+        vTaskDelay(COMMAND_PERIOD_MS);
+        task_wakes[TASK_COMMANDS]++;
+
+        if (boot_stage != BOOT_READY)
+        {
+            continue; //no commands during the boot, like before
+        }
+
+        if (tare_done == true)
+        {
+            tare_done = false;
+            save_tare_flash(-1.0f);
+        }
+
+        heap_guard_allow(true); //the Bluedroid stack takes and gives back its RAM
+        bt_button_service();
+        SerialBT.service(); //off after BT_IDLE_MS without a client
+        heap_guard_allow(false);
+
+        if (reboot_esp32 == true) //mqtt command to reboot esp32
+        {
+            print_serial_and_bt("", 1);
+            print_serial_and_bt("Reboot ESP32 in 2 sec.", 0);
+            print_serial_and_bt("", 1);
+
+            delay(2000);          // 5 sec on display
+            reboot_esp32 = false; //make no sence since it will reboot but anyway
+            ESP.restart();
+        }
+
+        //write a queued config save into flash (write-behind, not inside the wizards)
+        heap_guard_allow(true); //NVS keeps its page tables on the heap
+        config_store_service();
+        heap_guard_allow(false);
+
+        //check if some input from command line also for blue tooth
+        serial_available();
+    }
+}
+
+//telemetry task: the 's' data print, a slow BT print does not delay a sample
+void telemetry(void *parameter)
+{
+    long last_count = -1;
+    unsigned long heap_hits = 0;
+
+    for (;;)
+    {
+        vTaskDelay(TELEMETRY_PERIOD_MS);
+        task_wakes[TASK_TELEMETRY]++;
+
+        //STATIC_ALLOC: a running path did use the heap after setup(), tell it (once per new call)
+        if (heap_guard_hits() != heap_hits)
+        {
+            heap_hits = heap_guard_hits();
+            print_serial_and_bt("ASSERT heap used after setup, task ", 0);
+            print_serial_and_bt(heap_guard_last(), 0);
+            print_serial_and_bt(" calls ", 0);
+            print_num_serial_and_bt((long)heap_hits, 1);
+        }
+
+        if (SerialPrintData != 1 || boot_stage != BOOT_READY)
+        {
+            continue;
+        }
+
+        telemetry_t tm;
+        xSemaphoreTake(Semaphore, portMAX_DELAY);
+        tm = telemetry_snap;
+        xSemaphoreGive(Semaphore);
+
+        if (tm.count != last_count) //no print without a new sample (wizard running)
+        {
+            SerialPrintOutCollector(tm.count, tm.loadcellraw, tm.out, tm.normal, tm.gammafac, tm.weight_in_percent, tm.outputtype);
+            handoff_report();
+            last_count = tm.count;
+        }
+    }
+}
+
+#if !OUT_NULL
+//drain tasks: the slow writes of the text output, one for each transport
+void out_drain_serial(void *parameter)
+{
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(OUT_DRAIN_MS));
+        task_wakes[TASK_OUT_SERIAL]++;
+        out_sink_drain(serial_sink);
+    }
+}
+
+void out_drain_bt(void *parameter)
+{
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(OUT_DRAIN_MS));
+        task_wakes[TASK_OUT_BT]++;
+        if (!SerialBT.running())
+        {
+            out_sink_discard(bt_sink); //BT off, nobody to tell
+            continue;
+        }
+        heap_guard_allow(true); //the BT stack buffers its packets on the heap
+        out_sink_drain(bt_sink);
+        heap_guard_allow(false);
+    }
+}
+#endif
+
+//create task i of the task map with its function
+void task_start(int i, TaskFunction_t function)
+{
+    const task_map_t &tm = task_map[i];
+#if STATIC_ALLOC
+    *tm.handle = xTaskCreateStaticPinnedToCore(function, tm.name, tm.stack, NULL, tm.priority, tm.stack_buf, &task_tcb[i], tm.core);
+#else
+    xTaskCreatePinnedToCore(function, tm.name, tm.stack, NULL, tm.priority, tm.handle, tm.core);
+#endif
+    heap_guard_add(*tm.handle); //no heap after its start
+}
+
+void setup()
+{
+    //text output first, the prints of the boot wait in the buffers for the drain tasks
+    out_sink_init(serial_sink, "Serial", Serial, out_buf_serial, OUT_BUF_SERIAL);
+    out_sink_init(bt_sink, "SerialBT", SerialBT, out_buf_bt, OUT_BUF_BT);
+    out.add(serial_sink);
+    out.add(bt_sink);
+    out.wait_task(xTaskGetCurrentTaskHandle(), OUT_WAIT_MS);
+
+    //stage 1: config in one read and the 0% break voltage on the DAC before anything else
+    config_from_ram(flash_cfg);
+    config_store_load(flash_cfg);
+    config_to_ram(flash_cfg);
+    LoadCell.setCalFactor(newCalibrationValue);
+
+    dacWrite(DAC1, min_break_volt); //no floating output = no random break value on the console
+    boot_dac_valid_us = micros();
+
+    // Simple flag, up or down
+#if STATIC_ALLOC
+    Semaphore = xSemaphoreCreateMutexStatic(&semaphore_buf);
+    Acquire = xSemaphoreCreateMutexStatic(&acquire_buf);
+#else
+    Semaphore = xSemaphoreCreateMutex();
+    Acquire = xSemaphoreCreateMutex();
+#endif
+
+    task_start(TASK_OUTPUT, pwm2dac);
+
+    //stage 2: HX711 starts converting, stabilizing and tare are done in the acquisition task by boot_service()
+    LoadCell.begin();
+
+    //stage 3: the slow parts, the output is already valid
+    Serial.begin(115200);
+    delay(10);
+#if !OUT_NULL
+    task_start(TASK_OUT_SERIAL, out_drain_serial);
+    task_start(TASK_OUT_BT, out_drain_bt);
+    serial_sink.drain_task = TaskOutSerial;
+    bt_sink.drain_task = TaskOutBT;
+#endif
+    cmd_source_init(serial_cmd, &Serial, 0);
+    cmd_source_init(bt_cmd, &SerialBT, CMD_IDLE_MS); //BT apps send single chars without a line end
+
+    pinMode(BT_BUTTON, INPUT_PULLUP);
+    jitter_hist_reset(wake_hist);
+    jitter_hist_reset(output_hist);
+#if BT_AT_BOOT
+    if (!SerialBT.start()) //Bluetooth device name in the SerialBT constructor
+    {
+        print_serial_and_bt("Bluetooth did not start (Bluedroid)", 1);
+    }
+#endif
+
+    // Options are: 240 (default), 160, 80, 40, 20 and 10 MHz
+    setCpuFrequencyMhz(80); //Set CPU clock to 80MHz fo example
+    getCpuFrequencyMhz();   //Get CPU clock
+
+    print_serial_and_bt("", 1);
+    print_serial_and_bt("CPU Mhz: ", 0);
+    print_num_serial_and_bt((long)getCpuFrequencyMhz(), 0); //Get CPU clock)
+    print_serial_and_bt("", 1);
 
-        delay(2000);          // 5 sec on display
-        reboot_esp32 = false; //make no sence since it will reboot but anyway
-        ESP.restart();
+    if (SerialBT.running())
+    {
+        print_serial_and_bt("The device started, now you can pair it with bluetooth!", 1);
     }
+    else
+    {
+        print_serial_and_bt("The device started, Bluetooth is off: 'b' or hold the boot button 2 sec.", 1);
+    }
+
+    print_serial_and_bt("", 1);
+    print_serial_and_bt("Starting...", 1);
+
+    //file name of the sketch to have some controll over the sketches
+    //the part between the last '\\' and the '.'
+    const char *ino_start = strrchr(__FILE__, '\\');
+    ino_start = ino_start != NULL ? ino_start + 1 : __FILE__;
+    const char *ino_end = strchr(ino_start, '.');
+    int ino_len = ino_end != NULL ? ino_end - ino_start : strlen(ino_start);
+    ino_len = min(ino_len, (int)sizeof(ino) - 1);
+    memcpy(ino, ino_start, ino_len);
+    ino[ino_len] = 0;
+
+    load_variables_flash(0); //show the loaded variables
+
+    //stage 4: the tasks, the boot check of the load cell is the first work of the acquisition task
+    task_start(TASK_ACQUIRE, acquisition);
+    attachInterrupt(digitalPinToInterrupt(HX711_dout), hx711_dout_isr, FALLING);
+    task_start(TASK_TELEMETRY, telemetry);
+    task_start(TASK_COMMANDS, commands);
+    out.wait_task(TaskCommands, OUT_WAIT_MS); //the wizards print a lot at once
+}
 
-    //check if some input from command line also for blue tooth
-    serial_available();
-}
\ No newline at end of file
+void loop()
+{
+    //everything runs in the tasks of the task map
+    vTaskDelete(NULL);
+}
@@ -0,0 +1,250 @@
+/*
+   cfg_clone - copy the whole config of one rig to others (cfg_get / cfg_put of the firmware)
+
+   The blob is the same as in the flash slots: config_header_t (magic, version, length, CRC32)
+   and brake_config_t with calibration, limits, gamma, linearization, profiles and force curves.
+   The target keeps its own tare, everything else is taken over and saved.
+   Switch the serial print off ('s') before, its lines would be in the way.
+
+   USB: /dev/ttyUSB0, BT: bind the rig first (rfcomm bind 0 <address>) and use /dev/rfcomm0.
+
+   Build on the PC:  g++ -O2 -o cfg_clone cfg_clone.cpp
+   Run:              ./cfg_clone get /dev/ttyUSB0 rig.bin
+                     ./cfg_clone put /dev/ttyUSB0 rig.bin   (one call per rig)
+                     ./cfg_clone show rig.bin
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/select.h>
+
+#define CONFIG_MAGIC 0x4732 //as lib/config_store/config_store.h
+#define TIMEOUT_MS 5000
+
+//lib/config_store/config_store.h, the payload is only checked with the CRC here
+struct __attribute__((packed)) config_header_t
+{
+    uint16_t magic;
+    uint16_t version;
+    uint16_t length;
+    uint16_t reserved;
+    uint32_t sequence;
+    uint32_t crc;
+};
+
+static_assert(sizeof(config_header_t) == 16, "config_header_t layout changed");
+
+static uint32_t crc32_calc(const uint8_t *data, size_t len)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        for (uint8_t b = 0; b < 8; b++)
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
+
+//magic, length and CRC, prints the header
+static bool blob_check(const std::vector<uint8_t> &blob)
+{
+    config_header_t h;
+    if (blob.size() < sizeof(h))
+    {
+        std::fprintf(stderr, "blob too short (%zu bytes)\n", blob.size());
+        return false;
+    }
+    std::memcpy(&h, blob.data(), sizeof(h));
+    if (h.magic != CONFIG_MAGIC || h.length != blob.size() - sizeof(h))
+    {
+        std::fprintf(stderr, "no config blob (magic 0x%04x, length %u of %zu)\n", h.magic, h.length, blob.size() - sizeof(h));
+        return false;
+    }
+    if (crc32_calc(blob.data() + sizeof(h), h.length) != h.crc)
+    {
+        std::fprintf(stderr, "CRC wrong\n");
+        return false;
+    }
+    std::printf("config version %u, %u bytes, crc %08x\n", h.version, h.length, h.crc);
+    return true;
+}
+
+static int open_port(const char *path)
+{
+    int fd = open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0)
+    {
+        std::perror(path);
+        return -1;
+    }
+    termios tio;
+    if (tcgetattr(fd, &tio) == 0) //a rfcomm device has no baud rate, raw mode is enough
+    {
+        cfmakeraw(&tio);
+        cfsetispeed(&tio, B115200);
+        cfsetospeed(&tio, B115200);
+        tio.c_cc[VMIN] = 0;
+        tio.c_cc[VTIME] = 0;
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
+
+//one byte, -1 after timeout
+static int read_byte(int fd, int timeout_ms)
+{
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(fd, &set);
+    timeval tv = {timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+    if (select(fd + 1, &set, NULL, NULL, &tv) <= 0)
+        return -1;
+    uint8_t c;
+    return read(fd, &c, 1) == 1 ? c : -1;
+}
+
+//next line what starts with one of the words, other lines (telemetry, prints of the wizards) are skipped
+static bool read_reply(int fd, const char *word1, const char *word2, std::string &line)
+{
+    line.clear();
+    for (;;)
+    {
+        int c = read_byte(fd, TIMEOUT_MS);
+        if (c < 0)
+        {
+            std::fprintf(stderr, "no answer\n");
+            return false;
+        }
+        if (c != '\n' && c != '\r')
+        {
+            line += (char)c;
+            continue;
+        }
+        if (line.compare(0, std::strlen(word1), word1) == 0 || line.compare(0, std::strlen(word2), word2) == 0)
+            return true;
+        line.clear();
+    }
+}
+
+static bool send(int fd, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    while (len > 0)
+    {
+        ssize_t n = write(fd, p, len);
+        if (n <= 0)
+        {
+            std::perror("write");
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    tcdrain(fd);
+    return true;
+}
+
+static int cmd_get(const char *port, const char *file)
+{
+    int fd = open_port(port);
+    if (fd < 0)
+        return 1;
+    std::string line;
+    if (!send(fd, "cfg_get\n", 8) || !read_reply(fd, "BIN ", "ERR", line) || line.compare(0, 4, "BIN ") != 0)
+    {
+        std::fprintf(stderr, "cfg_get failed %s\n", line.c_str());
+        return 1;
+    }
+
+    size_t len = std::strtoul(line.c_str() + 4, NULL, 10);
+    std::vector<uint8_t> blob;
+    while (blob.size() < len)
+    {
+        int c = read_byte(fd, TIMEOUT_MS);
+        if (c < 0)
+        {
+            std::fprintf(stderr, "blob incomplete (%zu of %zu bytes)\n", blob.size(), len);
+            return 1;
+        }
+        blob.push_back((uint8_t)c);
+    }
+    close(fd);
+    if (!blob_check(blob))
+        return 1;
+
+    FILE *f = std::fopen(file, "wb");
+    if (!f || std::fwrite(blob.data(), 1, blob.size(), f) != blob.size())
+    {
+        std::perror(file);
+        return 1;
+    }
+    std::fclose(f);
+    std::printf("saved in %s\n", file);
+    return 0;
+}
+
+static bool load_file(const char *file, std::vector<uint8_t> &blob)
+{
+    FILE *f = std::fopen(file, "rb");
+    if (!f)
+    {
+        std::perror(file);
+        return false;
+    }
+    uint8_t buf[512];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0)
+        blob.insert(blob.end(), buf, buf + n);
+    std::fclose(f);
+    return blob_check(blob);
+}
+
+static int cmd_put(const char *port, const char *file)
+{
+    std::vector<uint8_t> blob;
+    if (!load_file(file, blob))
+        return 1;
+    int fd = open_port(port);
+    if (fd < 0)
+        return 1;
+
+    char cmd[32];
+    int n = std::snprintf(cmd, sizeof(cmd), "cfg_put %zu\n", blob.size());
+    std::string line;
+    if (!send(fd, cmd, n) || !read_reply(fd, "READY", "ERR", line) || line != "READY")
+    {
+        std::fprintf(stderr, "cfg_put refused %s\n", line.c_str());
+        return 1;
+    }
+    if (!send(fd, blob.data(), blob.size()) || !read_reply(fd, "OK", "ERR", line))
+        return 1;
+    close(fd);
+
+    std::printf("%s\n", line.c_str());
+    return line.compare(0, 2, "OK") == 0 ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 3 && std::strcmp(argv[1], "show") == 0)
+    {
+        std::vector<uint8_t> blob;
+        return load_file(argv[2], blob) ? 0 : 1;
+    }
+    if (argc == 4 && std::strcmp(argv[1], "get") == 0)
+        return cmd_get(argv[2], argv[3]);
+    if (argc == 4 && std::strcmp(argv[1], "put") == 0)
+        return cmd_put(argv[2], argv[3]);
+
+    std::fprintf(stderr, "usage: cfg_clone get|put <port> <file>\n       cfg_clone show <file>\n");
+    return 2;
+}
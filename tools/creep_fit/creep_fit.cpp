@@ -0,0 +1,132 @@
+/*
+   creep_fit - fits the creep model of the firmware (lib/creep) from a recorded trace
+
+   Record: 's' then 'c' on the ESP32 => every sample "millis,load" is printed.
+   Pedal idle, put a constant weight on the load cell, keep it there for 30-60 s.
+   Save the terminal output to a file (other lines are ignored).
+
+   Build on the PC:  g++ -O2 -o creep_fit creep_fit.cpp
+   Run:              ./creep_fit trace.txt
+
+   Model: constant force F reads as y(t) = F * (1 + A * (1 - exp(-t / tau)))
+   For every tau on a log grid, F and F*A are a linear least squares fit, the tau with
+   the smallest error wins. A (in %) and tau (in s) are entered with the 'k' command.
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+
+struct sample
+{
+    double t; //s
+    double y; //load
+};
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::fprintf(stderr, "usage: %s trace.txt [settle_s]\n", argv[0]);
+        return 1;
+    }
+    double settle_s = argc > 2 ? std::atof(argv[2]) : 0.3; //moving average of the HX711 lib after the step
+
+    FILE *f = std::fopen(argv[1], "r");
+    if (!f)
+    {
+        std::perror(argv[1]);
+        return 1;
+    }
+
+    std::vector<sample> trace;
+    char line[256];
+    while (std::fgets(line, sizeof(line), f))
+    {
+        double ms, load;
+        if (std::sscanf(line, "%lf,%lf", &ms, &load) == 2)
+        {
+            trace.push_back({ms / 1000.0, load});
+        }
+    }
+    std::fclose(f);
+
+    if (trace.size() < 50)
+    {
+        std::fprintf(stderr, "trace too short (%zu samples)\n", trace.size());
+        return 1;
+    }
+
+    //plateau = median of the last 10%, onset = first sample over half of it
+    std::vector<double> tail;
+    for (size_t i = trace.size() - trace.size() / 10; i < trace.size(); i++)
+        tail.push_back(trace[i].y);
+    std::nth_element(tail.begin(), tail.begin() + tail.size() / 2, tail.end());
+    double plateau = tail[tail.size() / 2];
+
+    size_t onset = 0;
+    while (onset < trace.size() && std::fabs(trace[onset].y) < 0.5 * std::fabs(plateau))
+        onset++;
+
+    std::vector<sample> fit;
+    for (size_t i = onset; i < trace.size(); i++)
+    {
+        double t = trace[i].t - trace[onset].t;
+        if (t >= settle_s)
+            fit.push_back({t, trace[i].y});
+    }
+    if (fit.size() < 20)
+    {
+        std::fprintf(stderr, "not enough samples after the step\n");
+        return 1;
+    }
+
+    double best_sse = INFINITY, best_tau = 0, best_a = 0, best_b = 0;
+    const int steps = 400;
+    for (int k = 0; k <= steps; k++)
+    {
+        double tau = 0.1 * std::pow(1000.0, (double)k / steps); //0.1 .. 100 s
+        //normal equations for y = a + b * g, g = 1 - exp(-t/tau)
+        double n = 0, sg = 0, sgg = 0, sy = 0, sgy = 0;
+        for (const sample &s : fit)
+        {
+            double g = 1.0 - std::exp(-s.t / tau);
+            n += 1;
+            sg += g;
+            sgg += g * g;
+            sy += s.y;
+            sgy += g * s.y;
+        }
+        double det = n * sgg - sg * sg;
+        if (std::fabs(det) < 1e-12)
+            continue;
+        double a = (sy * sgg - sg * sgy) / det;
+        double b = (n * sgy - sg * sy) / det;
+
+        double sse = 0;
+        for (const sample &s : fit)
+        {
+            double r = s.y - (a + b * (1.0 - std::exp(-s.t / tau)));
+            sse += r * r;
+        }
+        if (sse < best_sse)
+        {
+            best_sse = sse;
+            best_tau = tau;
+            best_a = a;
+            best_b = b;
+        }
+    }
+
+    double amplitude = best_b / best_a;
+    std::printf("samples used : %zu (from %.3f s after the step)\n", fit.size(), settle_s);
+    std::printf("force F      : %.4f\n", best_a);
+    std::printf("rms residual : %.4f\n", std::sqrt(best_sse / fit.size()));
+    std::printf("amplitude %% : %.3f\n", amplitude * 100.0);
+    std::printf("tau s        : %.3f\n", best_tau);
+    if (amplitude <= 0.0 || amplitude > 0.5)
+        std::printf("warning: amplitude out of the firmware range 0..50%%, check the trace\n");
+    return 0;
+}
@@ -0,0 +1,108 @@
+/*
+   dac_ramp - ramp response of the DAC output: staircase against lib/dac_interp
+
+   The load of a brake stab is given as DAC bit (40 => 200 in 500 ms, hold, release).
+   The HX711 samples it at sps, pwm2dac gives one value per output block, like on the ESP32:
+     staircase: the target of the last sample until the next one (DAC_INTERP_FAC 0)
+     ramp:      lib/dac_interp over one conversion (DAC_INTERP_FAC 1)
+   For each: the biggest jump between two output blocks, and against the true load on the ramp
+   the mean/max lag and the ripple (std. deviation of the lag, in bit).
+
+   Build on the PC:  g++ -O2 -I../../lib/dac_interp -o dac_ramp dac_ramp.cpp ../../lib/dac_interp/dac_interp.cpp
+   Run:              ./dac_ramp [sps] [output block in us]
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include "dac_interp.h"
+
+//true DAC target of the stab at t (s)
+static double stab(double t)
+{
+    const double low = 40.0, high = 200.0, rise = 0.5, hold = 0.5;
+    if (t < 0.1)
+        return low;
+    t -= 0.1;
+    if (t < rise)
+        return low + (high - low) * t / rise;
+    t -= rise;
+    if (t < hold)
+        return high;
+    t -= hold;
+    if (t < rise)
+        return high - (high - low) * t / rise;
+    return low;
+}
+
+struct result
+{
+    double max_jump;
+    double lag_mean_ms;
+    double lag_max_ms;
+    double ripple;
+};
+
+static result run(double sps, double block_us, double fac)
+{
+    const double slope = (200.0 - 40.0) / 0.5; //bit per s on the ramp
+    const double conversion_us = 1000000.0 / sps;
+    const unsigned long span = (unsigned long)(fac * conversion_us);
+
+    dac_interp_t di;
+    dac_interp_reset(di, (float)stab(0.0));
+
+    result r = {0.0, 0.0, 0.0, 0.0};
+    double last = stab(0.0);
+    double next_sample = 0.0;
+    double sum = 0.0, sq = 0.0;
+    int n = 0;
+    for (double us = 0.0; us < 2000000.0; us += block_us)
+    {
+        if (us >= next_sample)
+        {
+            dac_interp_target(di, (float)stab(next_sample / 1000000.0), (unsigned long)us, span);
+            next_sample += conversion_us;
+        }
+        double v = dac_interp_value(di, (unsigned long)us);
+        r.max_jump = std::max(r.max_jump, std::fabs(v - last));
+        last = v;
+
+        //rising ramp, without the first 2 conversions (start of the ramp)
+        double t = us / 1000000.0;
+        double edge = 2.0 / sps;
+        if (t > 0.1 + edge && t < 0.6)
+        {
+            double lag = (stab(t) - v) / slope * 1000.0;
+            sum += lag;
+            sq += lag * lag;
+            r.lag_max_ms = std::max(r.lag_max_ms, lag);
+            n++;
+        }
+    }
+    r.lag_mean_ms = sum / n;
+    r.ripple = std::sqrt(std::max(0.0, sq / n - r.lag_mean_ms * r.lag_mean_ms)) / 1000.0 * slope;
+    return r;
+}
+
+int main(int argc, char **argv)
+{
+    double sps = argc > 1 ? std::atof(argv[1]) : 89.0;
+    double block_us = argc > 2 ? std::atof(argv[2]) : 50.0;
+    if (sps <= 0.0 || block_us <= 0.0)
+    {
+        std::fprintf(stderr, "usage: dac_ramp [sps] [output block in us]\n");
+        return 1;
+    }
+
+    std::printf("%.1f SPS, output block %.0f us, ramp %.0f bit/s\n", sps, block_us, (200.0 - 40.0) / 0.5);
+    std::printf("%-10s %10s %12s %12s %10s\n", "output", "max jump", "lag mean ms", "lag max ms", "ripple");
+    const char *name[2] = {"staircase", "ramp"};
+    for (int i = 0; i < 2; i++)
+    {
+        result r = run(sps, block_us, i);
+        std::printf("%-10s %10.2f %12.2f %12.2f %10.2f\n", name[i], r.max_jump, r.lag_mean_ms, r.lag_max_ms, r.ripple);
+    }
+    return 0;
+}
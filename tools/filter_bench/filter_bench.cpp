@@ -0,0 +1,229 @@
+/*
+   filter_bench - onset latency against steady state noise of the load filters
+
+   Compares on the PC:
+     fixed:    HX711_ADC moving average as in the firmware (SAMPLES + 2, highest and lowest dropped)
+     adaptive: HX711_ADC with 1 sample (median of 3) and lib/adaptive_filter behind it
+     + pred:   the same with lib/predictor behind it (group delay of the filter extrapolated)
+
+   Without a file a synthetic trace is used (89 SPS, noise 1.0, stabs to 1000).
+   Recorded trace: 's' then 'c' on the ESP32 with the adaptive filter on ('h'), so the trace
+   is close to the raw HX711 data. Pedal idle for the first 2 s, then some fast stabs.
+
+   Build on the PC:  g++ -O2 -I../../lib/adaptive_filter -I../../lib/predictor -o filter_bench filter_bench.cpp
+                       ../../lib/adaptive_filter/adaptive_filter.cpp ../../lib/predictor/predictor.cpp
+   Run:              ./filter_bench [trace.txt] [samples]
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include "adaptive_filter.h"
+#include "predictor.h"
+
+struct sample
+{
+    double t; //s
+    double y; //load
+};
+
+//HX711_ADC smoothedData(): ring of samples + 2, sum minus highest and lowest
+struct hx711_smooth
+{
+    std::vector<double> ring;
+    size_t index = 0;
+    int samples;
+
+    explicit hx711_smooth(int s) : ring(s + 2, 0.0), samples(s) {}
+
+    double update(double x)
+    {
+        ring[index] = x;
+        index = (index + 1) % ring.size();
+        double sum = 0.0, hi = ring[0], lo = ring[0];
+        for (double v : ring)
+        {
+            sum += v;
+            hi = std::max(hi, v);
+            lo = std::min(lo, v);
+        }
+        return (sum - hi - lo) / samples;
+    }
+};
+
+static std::vector<sample> synthetic()
+{
+    std::vector<sample> trace;
+    const double dt = 1.0 / 89.0;
+    unsigned int seed = 12345;
+    auto gauss = [&seed]() {
+        double u1 = (rand_r(&seed) + 1.0) / (RAND_MAX + 2.0);
+        double u2 = (rand_r(&seed) + 1.0) / (RAND_MAX + 2.0);
+        return std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * M_PI * u2);
+    };
+
+    double t = 0.0;
+    auto add = [&](double level, double seconds) {
+        for (int i = 0; i < (int)(seconds / dt); i++, t += dt)
+            trace.push_back({t, level + gauss()});
+    };
+    add(0.0, 2.0);
+    for (int press = 0; press < 8; press++)
+    {
+        for (int k = 1; k <= 3; k++) //stab: 3 samples to full load
+            add(1000.0 * k / 3.0, dt);
+        add(1000.0, 1.0);
+        add(0.0, 1.0);
+    }
+    return trace;
+}
+
+struct result
+{
+    double noise;
+    double onset50_ms;
+    double onset90_ms;
+    int onsets;
+};
+
+//latency: filtered output crosses 50% / 90% of the stab after the raw data did
+static result measure(const std::vector<sample> &raw, const std::vector<double> &out, double base, double top, size_t idle)
+{
+    result r = {0.0, 0.0, 0.0, 0};
+
+    double mean = 0.0, sq = 0.0;
+    size_t n = 0;
+    for (size_t i = idle / 2; i < idle; i++) //second half of the idle part, the filters are settled
+    {
+        mean += out[i];
+        sq += out[i] * out[i];
+        n++;
+    }
+    mean /= n;
+    r.noise = std::sqrt(std::max(0.0, sq / n - mean * mean));
+
+    double level50 = base + 0.5 * (top - base);
+    double level90 = base + 0.9 * (top - base);
+    int n90 = 0;
+    for (size_t i = std::max<size_t>(idle, 1); i < raw.size(); i++)
+    {
+        if (!(raw[i - 1].y < level50 && raw[i].y >= level50))
+            continue;
+
+        size_t j = i;
+        while (j < raw.size() && out[j] < level50)
+            j++;
+        if (j == raw.size())
+            break;
+        r.onset50_ms += (raw[j].t - raw[i].t) * 1000.0;
+        r.onsets++;
+
+        size_t k = i;
+        while (k < raw.size() && raw[k].y < level90 && k < i + 20)
+            k++;
+        if (k == raw.size() || raw[k].y < level90)
+            continue; //this stab did not go to 90%
+        size_t m = k;
+        while (m < raw.size() && out[m] < level90)
+            m++;
+        if (m == raw.size())
+            continue;
+        r.onset90_ms += (raw[m].t - raw[k].t) * 1000.0;
+        n90++;
+    }
+    if (r.onsets > 0)
+        r.onset50_ms /= r.onsets;
+    if (n90 > 0)
+        r.onset90_ms /= n90;
+    return r;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<sample> trace;
+    int samples = argc > 2 ? std::atoi(argv[2]) : 16;
+
+    if (argc > 1)
+    {
+        FILE *f = std::fopen(argv[1], "r");
+        if (!f)
+        {
+            std::perror(argv[1]);
+            return 1;
+        }
+        char line[256];
+        while (std::fgets(line, sizeof(line), f))
+        {
+            double ms, load;
+            if (std::sscanf(line, "%lf,%lf", &ms, &load) == 2)
+            {
+                trace.push_back({ms / 1000.0, load});
+            }
+        }
+        std::fclose(f);
+    }
+    else
+    {
+        trace = synthetic();
+    }
+
+    if (trace.size() < 300)
+    {
+        std::fprintf(stderr, "trace too short (%zu samples)\n", trace.size());
+        return 1;
+    }
+
+    //idle part: the first 2 s
+    size_t idle = 0;
+    while (idle < trace.size() && trace[idle].t - trace[0].t < 2.0)
+        idle++;
+
+    std::vector<double> sorted;
+    for (const sample &s : trace)
+        sorted.push_back(s.y);
+    std::sort(sorted.begin(), sorted.end());
+    double top = sorted[sorted.size() * 98 / 100];
+    double base = 0.0;
+    for (size_t i = 0; i < idle; i++)
+        base += trace[i].y;
+    base /= idle;
+
+    std::vector<double> fixed_out, adaptive_out, fixed_pred_out, adaptive_pred_out;
+    hx711_smooth fixed(samples);
+    hx711_smooth median3(1);
+    adaptive_filter_t af;
+    adaptive_filter_reset(af);
+    predictor_t fixed_pd, adaptive_pd;
+    predictor_reset(fixed_pd);
+    predictor_reset(adaptive_pd);
+    for (size_t i = 0; i < trace.size(); i++)
+    {
+        double dt = i > 0 ? trace[i].t - trace[i - 1].t : 0.0;
+
+        //group delay as in the firmware: centre of the window
+        float f = (float)fixed.update(trace[i].y);
+        fixed_out.push_back(f);
+        fixed_pred_out.push_back(predictor_update(fixed_pd, f, (float)dt, (float)(dt * (samples + 1) / 2.0), (float)top));
+
+        float a = adaptive_filter_update(af, (float)median3.update(trace[i].y), samples);
+        adaptive_out.push_back(a);
+        adaptive_pred_out.push_back(predictor_update(adaptive_pd, a, (float)dt, (float)(dt * (1.0 + (af.window - 1) / 2.0)), (float)top));
+    }
+
+    result rf = measure(trace, fixed_out, base, top, idle);
+    result ra = measure(trace, adaptive_out, base, top, idle);
+    result rfp = measure(trace, fixed_pred_out, base, top, idle);
+    result rap = measure(trace, adaptive_pred_out, base, top, idle);
+
+    std::printf("%zu samples, %.1f SPS, stab %.1f -> %.1f\n", trace.size(),
+                (trace.size() - 1) / (trace.back().t - trace.front().t), base, top);
+    std::printf("filter               noise(std)   onset 50%% ms   onset 90%% ms   stabs\n");
+    std::printf("fixed %2d+2           %10.3f   %12.1f   %12.1f   %5d\n", samples, rf.noise, rf.onset50_ms, rf.onset90_ms, rf.onsets);
+    std::printf("adaptive max %2d      %10.3f   %12.1f   %12.1f   %5d\n", samples, ra.noise, ra.onset50_ms, ra.onset90_ms, ra.onsets);
+    std::printf("fixed %2d+2 + pred    %10.3f   %12.1f   %12.1f   %5d\n", samples, rfp.noise, rfp.onset50_ms, rfp.onset90_ms, rfp.onsets);
+    std::printf("adaptive %2d + pred   %10.3f   %12.1f   %12.1f   %5d\n", samples, rap.noise, rap.onset50_ms, rap.onset90_ms, rap.onsets);
+    std::printf("adaptive onsets detected: %lu\n", af.onsets);
+    return 0;
+}
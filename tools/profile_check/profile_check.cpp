@@ -0,0 +1,211 @@
+/*
+   profile_check - rig test: a key=value batch without "save", a profile switch and the switch back
+
+   The batch is only live until the profile is left: after the switch back the stored profile
+   must be active again, and after a reboot all parameters must be the ones from before the batch.
+   Two used profiles are needed, the rig must be on the first one.
+   Switch the serial print off ('s') before, its lines would be in the way.
+
+   Build on the PC:  g++ -O2 -o profile_check profile_check.cpp
+   Run:              ./profile_check /dev/ttyUSB0 1 2   (active profile, other used profile)
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/select.h>
+
+#define TIMEOUT_MS 5000
+#define BOOT_TRIES 15 //"?" every TIMEOUT_MS after the reboot, the commands start after the boot tare
+
+static int open_port(const char *path)
+{
+    int fd = open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0)
+    {
+        std::perror(path);
+        return -1;
+    }
+    termios tio;
+    if (tcgetattr(fd, &tio) == 0) //a rfcomm device has no baud rate, raw mode is enough
+    {
+        cfmakeraw(&tio);
+        cfsetispeed(&tio, B115200);
+        cfsetospeed(&tio, B115200);
+        tio.c_cc[VMIN] = 0;
+        tio.c_cc[VTIME] = 0;
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
+
+//one byte, -1 after timeout
+static int read_byte(int fd, int timeout_ms)
+{
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(fd, &set);
+    timeval tv = {timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+    if (select(fd + 1, &set, NULL, NULL, &tv) <= 0)
+        return -1;
+    uint8_t c;
+    return read(fd, &c, 1) == 1 ? c : -1;
+}
+
+//next line what starts with one of the words, other lines are skipped
+static bool read_reply(int fd, const char *word1, const char *word2, std::string &line)
+{
+    line.clear();
+    for (;;)
+    {
+        int c = read_byte(fd, TIMEOUT_MS);
+        if (c < 0)
+        {
+            std::fprintf(stderr, "no answer\n");
+            return false;
+        }
+        if (c != '\n' && c != '\r')
+        {
+            line += (char)c;
+            continue;
+        }
+        if (line.compare(0, std::strlen(word1), word1) == 0 || line.compare(0, std::strlen(word2), word2) == 0)
+            return true;
+        line.clear();
+    }
+}
+
+static bool send_line(int fd, const std::string &text)
+{
+    std::string s = text + "\n";
+    if (write(fd, s.data(), s.size()) != (ssize_t)s.size())
+    {
+        std::perror("write");
+        return false;
+    }
+    tcdrain(fd);
+    return true;
+}
+
+//a command and its OK / ERR reply
+static bool command(int fd, const std::string &text, std::string &line)
+{
+    if (!send_line(fd, text) || !read_reply(fd, "OK", "ERR", line))
+        return false;
+    if (line.compare(0, 2, "OK") != 0)
+    {
+        std::fprintf(stderr, "%s: %s\n", text.c_str(), line.c_str());
+        return false;
+    }
+    return true;
+}
+
+//"?" => all parameters in one line
+static bool params(int fd, std::string &line)
+{
+    return send_line(fd, "?") && read_reply(fd, "OK max_break=", "ERR", line) && line.compare(0, 2, "OK") == 0;
+}
+
+//value of one key in the "?" line
+static float param(const std::string &line, const char *key)
+{
+    std::string k = std::string(" ") + key + "=";
+    size_t pos = line.find(k);
+    return pos == std::string::npos ? -1.0f : std::strtof(line.c_str() + pos + k.size(), NULL);
+}
+
+//the profile keys, the rig wide ones (normal, creep, ...) of a batch stay live until the reboot
+static const char *profile_keys[] = {"max_break", "min_break", "max_break_redfac", "max_break_volt", "min_break_volt", "gammafac", "filter_samples"};
+
+//keys of line a what differ in line b, 0 = all the same
+static int compare(const std::string &a, const std::string &b, const char *when)
+{
+    int failed = 0;
+    for (size_t pos = a.find(' '); pos != std::string::npos; pos = a.find(' ', pos + 1))
+    {
+        std::string key = a.substr(pos + 1, a.find('=', pos) - pos - 1);
+        if (param(a, key.c_str()) != param(b, key.c_str()))
+        {
+            std::printf("FAIL %s: %g before, %g %s\n", key.c_str(), param(a, key.c_str()), param(b, key.c_str()), when);
+            failed++;
+        }
+    }
+    return failed;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 4)
+    {
+        std::fprintf(stderr, "usage: profile_check <port> <active profile> <other profile>\n");
+        return 2;
+    }
+    int fd = open_port(argv[1]);
+    if (fd < 0)
+        return 1;
+    std::string back = std::string("p") + argv[2];
+    std::string other = std::string("p") + argv[3];
+
+    std::string before, batch, after, line;
+    if (!params(fd, before))
+        return 1;
+
+    //a batch what differs in a profile key and a rig wide key
+    float gamma = param(before, "gammafac");
+    int normal = (int)param(before, "normal");
+    char text[64];
+    std::snprintf(text, sizeof(text), "gammafac=%.2f normal=%d", gamma < 2.0f ? gamma + 0.5f : gamma - 0.5f, 1 - normal);
+    if (!command(fd, text, line) || !params(fd, batch))
+        return 1;
+    if (param(batch, "gammafac") == gamma)
+    {
+        std::fprintf(stderr, "batch not taken: %s\n", batch.c_str());
+        return 1;
+    }
+
+    if (!command(fd, other, line) || !command(fd, back, line) || !params(fd, after))
+        return 1;
+
+    int failed = 0;
+    for (const char *key : profile_keys)
+    {
+        if (param(after, key) != param(before, key))
+        {
+            std::printf("FAIL %s: %g before, %g after the switch back\n", key, param(before, key), param(after, key));
+            failed++;
+        }
+    }
+
+    //nothing of the batch may be in the flash
+    if (!command(fd, "r", line))
+        return 1;
+    sleep(2); //the command task restarts the ESP32 before it reads the next line
+    bool up = false;
+    for (int n = 0; n < BOOT_TRIES && !up; n++)
+    {
+        tcflush(fd, TCIFLUSH);
+        up = send_line(fd, "?") && read_reply(fd, "OK max_break=", "OK max_break=", line);
+    }
+    close(fd);
+    if (!up)
+    {
+        std::fprintf(stderr, "no answer after the reboot\n");
+        return 1;
+    }
+    failed += compare(before, line, "after the reboot");
+
+    if (failed > 0)
+    {
+        std::printf("%d checks failed\n", failed);
+        return 1;
+    }
+    std::printf("OK batch dropped by the switch, stored profile active\n");
+    return 0;
+}